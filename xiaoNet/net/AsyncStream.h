@@ -10,6 +10,7 @@
 #pragma once
 
 #include <xiaoNet/utils/NonCopyable.h>
+#include <functional>
 #include <memory>
 #include <string>
 
@@ -30,14 +31,45 @@ namespace xiaoNet
          *
          * @param data
          * @param len
-         * @return true
-         * @return false
+         * @return true if the data is accepted.
+         * @return false if the connection is closed, or if the stream already
+         * holds at least the high water mark of unsent bytes. In the latter
+         * case, send the data again after the writable callback is called.
          */
         virtual bool send(const char *data, size_t len) = 0;
         bool send(const std::string &data)
         {
             return send(data.data(), data.length());
         }
+        /**
+         * @brief Send data asynchronously, taking the ownership of the buffer
+         * so that it is queued without being copied.
+         *
+         * @note The string is not moved from if false is returned.
+         */
+        virtual bool send(std::string &&data) = 0;
+
+        /**
+         * @brief Bound the unsent bytes of the stream.
+         *
+         * @param highWaterMark send() refuses data once the stream holds this
+         * many unsent bytes, 0 (the default) means unbounded.
+         * @param lowWaterMark The writable callback is called when the unsent
+         * bytes drop to this after data was refused.
+         */
+        virtual void setWaterMarks(size_t highWaterMark,
+                                   size_t lowWaterMark) = 0;
+
+        /**
+         * @brief Return true if send() accepts data.
+         */
+        virtual bool isWritable() const = 0;
+
+        /**
+         * @brief Set the callback called, in the connection's event loop,
+         * when the stream becomes writable again after send() refused data.
+         */
+        virtual void setWritableCallback(std::function<void()> callback) = 0;
         /**
          * @brief Terminate the stream.
          *
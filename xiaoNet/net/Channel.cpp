@@ -10,6 +10,7 @@
 
 #include "Channel.h"
 #include <xiaoNet/net/EventLoop.h>
+#include "HotPathLog.h"
 
 #ifdef _WIN32
 
@@ -43,7 +44,7 @@ namespace xiaoNet
 
     void Channel::handleEvent()
     {
-        LOG_DEBUG << "handleEvent called, fd: " << fd_ << ", events: " << events_;
+        LOG_DEBUG_HOT << "handleEvent called, fd: " << fd_ << ", events: " << events_;
         if (events_ == kNoneEvent)
             return;
         if (tied_)
@@ -61,7 +62,7 @@ namespace xiaoNet
     }
     void Channel::handleEventSafely()
     {
-        LOG_DEBUG << "handleEventSafely called, fd: " << fd_ << ", revents: " << revents_;
+        LOG_DEBUG_HOT << "handleEventSafely called, fd: " << fd_ << ", revents: " << revents_;
         // 检查是否存在事件回调
         if (eventCallback_)
         {
@@ -15,6 +15,7 @@
 #include "Poller.h"
 #include "TimerQueue.h"
 #include "Channel.h"
+#include "HotPathLog.h"
 
 #ifdef _WIN32
 #else
@@ -183,8 +184,11 @@ namespace xiaoNet
             while (!quit_.load(std::memory_order_acquire))
             {
                 activeChannels_.clear(); // 每次循环开始时，清空，用来存储当前活跃的事件通道
+                // Don't block when functions wait for this iteration.
+                currentIterationFuncs_.swap(nextIterationFuncs_);
 #ifdef __linux__
-                poller_->poll(kPollTimeMs, &activeChannels_);
+                poller_->poll(currentIterationFuncs_.empty() ? kPollTimeMs : 0,
+                              &activeChannels_);
 #else
 #endif
                 eventHandling_ = true;
@@ -196,6 +200,11 @@ namespace xiaoNet
                 currentActiveChannel_ = nullptr;
                 eventHandling_ = false;
 
+                for (auto &func : currentIterationFuncs_)
+                {
+                    func();
+                }
+                currentIterationFuncs_.clear();
                 doRunInLoopFuncs();
             }
         }
@@ -227,25 +236,31 @@ namespace xiaoNet
     }
     void EventLoop::queueInLoop(const Func &cb)
     {
-        LOG_DEBUG << "EventLoop::queueInLoop called";
+        LOG_DEBUG_HOT << "EventLoop::queueInLoop called";
         funcs_.enqueue(cb);
         if (!isInLoopThread() || !looping_.load(std::memory_order_acquire))
         {
-            LOG_DEBUG << " wakeup() called";
+            LOG_DEBUG_HOT << " wakeup() called";
             wakeup();
         }
     }
     void EventLoop::queueInLoop(Func &&cb)
     {
-        LOG_DEBUG << "EventLoop::queueInLoop called";
+        LOG_DEBUG_HOT << "EventLoop::queueInLoop called";
         funcs_.enqueue(std::move(cb));
         if (!isInLoopThread() || !looping_.load(std::memory_order_acquire))
         {
-            LOG_DEBUG << " wakeup() called, isInLoopThread: " << isInLoopThread() << " looping_: " << looping_.load(std::memory_order_acquire);
+            LOG_DEBUG_HOT << " wakeup() called, isInLoopThread: " << isInLoopThread() << " looping_: " << looping_.load(std::memory_order_acquire);
             wakeup();
         }
     }
 
+    void EventLoop::queueInNextIteration(Func &&cb)
+    {
+        assertInLoopThread();
+        nextIterationFuncs_.push_back(std::move(cb));
+    }
+
     TimerId EventLoop::runAt(const Date &time, const Func &cb)
     {
         auto microSeconds =
@@ -290,7 +305,6 @@ namespace xiaoNet
     }
     void EventLoop::invalidateTimer(TimerId id)
     {
-        std::cout << isRunning() << std::endl;
         if (isRunning() && timerQueue_)
             timerQueue_->invalidateTimer(id);
     }
@@ -313,7 +327,7 @@ namespace xiaoNet
     }
     void EventLoop::wakeup()
     {
-        LOG_DEBUG << "wakeup called, wakeupFd_" << wakeupFd_;
+        LOG_DEBUG_HOT << "wakeup called, wakeupFd_" << wakeupFd_;
         uint64_t tmp = 1;
 #ifdef __linux__
         int ret = write(wakeupFd_, &tmp, sizeof(tmp));
@@ -324,7 +338,7 @@ namespace xiaoNet
     }
     void EventLoop::wakeupRead()
     {
-        LOG_DEBUG << "wakeupRead called, wakeupFd_" << wakeupFd_;
+        LOG_DEBUG_HOT << "wakeupRead called, wakeupFd_" << wakeupFd_;
         ssize_t ret = 0;
 #ifdef __linux__
         uint64_t tmp;
@@ -135,6 +135,18 @@ namespace xiaoNet
         void queueInLoop(const Func &f);
         void queueInLoop(Func &&f);
 
+        /**
+         * @brief Run the function f in the next iteration of the event loop,
+         * after the events of that iteration are handled. Unlike with
+         * queueInLoop(), a function queued this way from such a function
+         * doesn't run in the same iteration, so functions rescheduling
+         * themselves don't starve the other channels of the loop.
+         *
+         * @param f
+         * @note This method must be called in the thread of the event loop.
+         */
+        void queueInNextIteration(Func &&f);
+
         /**
          * @brief Run a function at a time point.
          *
@@ -300,6 +312,9 @@ namespace xiaoNet
         std::unique_ptr<TimerQueue> timerQueue_;
         MpscQueue<Func> funcsOnQuit_;
         bool callingFuncs_{false};
+        // Functions for the next iteration, only used in the loop thread.
+        std::vector<Func> nextIterationFuncs_;
+        std::vector<Func> currentIterationFuncs_;
 #ifdef __linux__
         int wakeupFd_;
         std::unique_ptr<Channel> wakeupChannelPtr_;
@@ -0,0 +1,148 @@
+/**
+ * @file FileCache.cpp
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ *
+ */
+
+#include <xiaoNet/net/FileCache.h>
+#include <xiaoLog/Logger.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace xiaoNet;
+
+namespace
+{
+    bool sameFile(const struct stat &a, const struct stat &b)
+    {
+        return a.st_ino == b.st_ino && a.st_dev == b.st_dev &&
+               a.st_size == b.st_size && a.st_mtim.tv_sec == b.st_mtim.tv_sec &&
+               a.st_mtim.tv_nsec == b.st_mtim.tv_nsec;
+    }
+
+    CachedFilePtr openFile(const char *path)
+    {
+        int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return nullptr;
+        struct stat st;
+        if (::fstat(fd, &st) < 0)
+        {
+            auto err = errno;
+            ::close(fd);
+            errno = err;
+            return nullptr;
+        }
+        return std::make_shared<CachedFile>(fd, st);
+    }
+}  // namespace
+
+CachedFile::~CachedFile()
+{
+    if (fd_ >= 0)
+        ::close(fd_);
+}
+
+FileCache &FileCache::instance()
+{
+    static FileCache cache;
+    return cache;
+}
+
+CachedFilePtr FileCache::open(const char *path)
+{
+    auto now = std::chrono::steady_clock::now();
+    std::string key(path);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto iter = index_.find(key);
+        if (iter != index_.end())
+        {
+            auto entry = iter->second;
+            entries_.splice(entries_.begin(), entries_, entry);
+            if (now - entry->checkedAt < revalidateInterval_)
+                return entry->file;
+        }
+    }
+    // stat() and open() are done without holding the lock.
+    struct stat st;
+    if (::stat(path, &st) < 0)
+    {
+        auto err = errno;
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto iter = index_.find(key);
+        if (iter != index_.end())
+        {
+            entries_.erase(iter->second);
+            index_.erase(iter);
+        }
+        errno = err;
+        return nullptr;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto iter = index_.find(key);
+        if (iter != index_.end() &&
+            sameFile(iter->second->file->fileStat(), st))
+        {
+            iter->second->checkedAt = now;
+            return iter->second->file;
+        }
+    }
+    auto file = openFile(path);
+    if (!file)
+        return nullptr;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (capacity_ == 0)
+        return file;
+    auto iter = index_.find(key);
+    if (iter != index_.end())
+    {
+        iter->second->file = file;
+        iter->second->checkedAt = now;
+        entries_.splice(entries_.begin(), entries_, iter->second);
+        return file;
+    }
+    entries_.push_front(Entry{key, file, now});
+    index_[key] = entries_.begin();
+    while (entries_.size() > capacity_)
+    {
+        index_.erase(entries_.back().path);
+        entries_.pop_back();
+    }
+    return file;
+}
+
+void FileCache::setCapacity(size_t capacity)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    capacity_ = capacity;
+    while (entries_.size() > capacity_)
+    {
+        index_.erase(entries_.back().path);
+        entries_.pop_back();
+    }
+}
+
+void FileCache::setRevalidateInterval(std::chrono::milliseconds interval)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    revalidateInterval_ = interval;
+}
+
+void FileCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    index_.clear();
+    entries_.clear();
+}
+
+size_t FileCache::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
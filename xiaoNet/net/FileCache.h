@@ -0,0 +1,118 @@
+/**
+ * @file FileCache.h
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ *
+ */
+
+#pragma once
+#include <xiaoNet/exports.h>
+#include <xiaoNet/utils/NonCopyable.h>
+#include <chrono>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+namespace xiaoNet
+{
+    /**
+     * @brief An open file shared by the transfers of the same path. The file
+     * descriptor is closed when the last user releases it, so it must be
+     * used with explicit offsets (pread(), sendfile() with an offset), never
+     * with the shared file position.
+     *
+     */
+    class XIAONET_EXPORT CachedFile : public NonCopyable
+    {
+    public:
+        CachedFile(int fd, const struct stat &st) : fd_(fd), stat_(st)
+        {
+        }
+        ~CachedFile();
+        int fd() const
+        {
+            return fd_;
+        }
+        long long size() const
+        {
+            return static_cast<long long>(stat_.st_size);
+        }
+        const struct stat &fileStat() const
+        {
+            return stat_;
+        }
+
+    private:
+        int fd_;
+        struct stat stat_;
+    };
+    using CachedFilePtr = std::shared_ptr<CachedFile>;
+
+    /**
+     * @brief A process-wide, size-bounded LRU cache of open files and their
+     * stat results, used by TcpConnection::sendFile() so that sending the
+     * same file repeatedly doesn't open and stat it every time.
+     * An entry is revalidated with stat() when it is older than the
+     * revalidation interval, and reopened if the file was replaced or
+     * modified (inode, size or mtime changed).
+     *
+     */
+    class XIAONET_EXPORT FileCache : public NonCopyable
+    {
+    public:
+        static FileCache &instance();
+
+        /**
+         * @brief Get the open file at path.
+         *
+         * @return CachedFilePtr nullptr if the file can't be opened, errno is
+         * set in that case.
+         */
+        CachedFilePtr open(const char *path);
+
+        /**
+         * @brief Set the maximum number of cached files, 0 disables caching.
+         *
+         */
+        void setCapacity(size_t capacity);
+
+        /**
+         * @brief Set how long an entry is trusted without calling stat().
+         *
+         */
+        void setRevalidateInterval(std::chrono::milliseconds interval);
+
+        /**
+         * @brief Drop all entries. Files still being sent stay open until
+         * the transfers finish.
+         *
+         */
+        void clear();
+
+        size_t size() const;
+
+    private:
+        FileCache() = default;
+        struct Entry
+        {
+            std::string path;
+            CachedFilePtr file;
+            std::chrono::steady_clock::time_point checkedAt;
+        };
+        using EntryList = std::list<Entry>;
+
+        mutable std::mutex mutex_;
+        // Most recently used entries first
+        EntryList entries_;
+        std::unordered_map<std::string, EntryList::iterator> index_;
+        size_t capacity_{1024};
+        std::chrono::milliseconds revalidateInterval_{1000};
+    };
+}
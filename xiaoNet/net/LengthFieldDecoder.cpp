@@ -0,0 +1,61 @@
+/**
+ * @file LengthFieldDecoder.cpp
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ *
+ */
+
+#include <xiaoNet/net/LengthFieldDecoder.h>
+
+using namespace xiaoNet;
+
+LengthFieldDecoder::LengthFieldDecoder(size_t lengthFieldOffset,
+                                       size_t lengthFieldLength,
+                                       long long lengthAdjustment,
+                                       size_t initialBytesToStrip,
+                                       size_t maxFrameLength)
+    : lengthFieldOffset_(lengthFieldOffset),
+      lengthFieldLength_(lengthFieldLength),
+      lengthAdjustment_(lengthAdjustment),
+      initialBytesToStrip_(initialBytesToStrip),
+      maxFrameLength_(maxFrameLength)
+{
+    assert(lengthFieldLength == 1 || lengthFieldLength == 2 ||
+           lengthFieldLength == 4 || lengthFieldLength == 8);
+}
+
+FrameStatus LengthFieldDecoder::decode(const MsgBuffer &buffer,
+                                       FrameView &frame,
+                                       size_t &frameLength) const
+{
+    const size_t headerLength = lengthFieldOffset_ + lengthFieldLength_;
+    if (buffer.readableBytes() < headerLength)
+        return FrameStatus::kNeedMore;
+    auto p =
+        reinterpret_cast<const unsigned char *>(buffer.peek()) +
+        lengthFieldOffset_;
+    uint64_t fieldValue = 0;
+    for (size_t i = 0; i < lengthFieldLength_; ++i)
+        fieldValue = (fieldValue << 8) | p[i];
+    // keep the arithmetic below from overflowing
+    if (fieldValue > (1ULL << 62))
+        return FrameStatus::kTooLarge;
+
+    long long total = static_cast<long long>(headerLength) +
+                      static_cast<long long>(fieldValue) + lengthAdjustment_;
+    if (total < static_cast<long long>(headerLength) ||
+        static_cast<size_t>(total) < initialBytesToStrip_)
+        return FrameStatus::kMalformed;
+    if (static_cast<size_t>(total) > maxFrameLength_)
+        return FrameStatus::kTooLarge;
+    if (buffer.readableBytes() < static_cast<size_t>(total))
+        return FrameStatus::kNeedMore;
+
+    frameLength = static_cast<size_t>(total);
+    frame.data = buffer.peek() + initialBytesToStrip_;
+    frame.length = frameLength - initialBytesToStrip_;
+    return FrameStatus::kComplete;
+}
@@ -0,0 +1,97 @@
+/**
+ * @file LengthFieldDecoder.h
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ *
+ */
+
+#pragma once
+#include <xiaoNet/exports.h>
+#include <xiaoNet/utils/MsgBuffer.h>
+
+namespace xiaoNet
+{
+    /**
+     * @brief This class splits a byte stream into frames by a length field in
+     * the frame header. The layout of a frame is:
+     * @code
+       | lengthFieldOffset bytes | length field | the rest of the frame |
+       @endcode
+     * and the total length of a frame is
+     * lengthFieldOffset + lengthFieldLength + value of the length field +
+     * lengthAdjustment.
+     * @note The length field is unsigned and big-endian.
+     */
+    class XIAONET_EXPORT LengthFieldDecoder
+    {
+    public:
+        static constexpr size_t kDefaultMaxFrameLength{16 * 1024 * 1024};
+
+        /**
+         * @brief Construct a new Length Field Decoder object
+         *
+         * @param lengthFieldOffset The offset of the length field in a frame.
+         * @param lengthFieldLength The width of the length field, it must be 1,
+         * 2, 4 or 8.
+         * @param lengthAdjustment The value added to the length field to get the
+         * number of bytes after the length field. For example, it is -4 if the
+         * length field is 4 bytes wide and counts itself.
+         * @param initialBytesToStrip The number of bytes removed from the
+         * beginning of a frame before it is delivered, usually used to drop the
+         * header.
+         * @param maxFrameLength The maximum total length of a frame.
+         */
+        explicit LengthFieldDecoder(
+            size_t lengthFieldOffset = 0,
+            size_t lengthFieldLength = 4,
+            long long lengthAdjustment = 0,
+            size_t initialBytesToStrip = 0,
+            size_t maxFrameLength = kDefaultMaxFrameLength);
+
+        /**
+         * @brief Find the first frame in the buffer. The buffer is not modified.
+         *
+         * @param buffer
+         * @param frame The frame (after stripping), it points into the buffer.
+         * @param frameLength The total length of the frame. The caller should
+         * retrieve this number of bytes from the buffer after the frame is
+         * processed.
+         * @return FrameStatus The frame and the frameLength are only set when
+         * kComplete is returned.
+         */
+        FrameStatus decode(const MsgBuffer &buffer,
+                           FrameView &frame,
+                           size_t &frameLength) const;
+
+        size_t lengthFieldOffset() const
+        {
+            return lengthFieldOffset_;
+        }
+        size_t lengthFieldLength() const
+        {
+            return lengthFieldLength_;
+        }
+        long long lengthAdjustment() const
+        {
+            return lengthAdjustment_;
+        }
+        size_t initialBytesToStrip() const
+        {
+            return initialBytesToStrip_;
+        }
+        size_t maxFrameLength() const
+        {
+            return maxFrameLength_;
+        }
+
+    private:
+        size_t lengthFieldOffset_;
+        size_t lengthFieldLength_;
+        long long lengthAdjustment_;
+        size_t initialBytesToStrip_;
+        size_t maxFrameLength_;
+    };
+}
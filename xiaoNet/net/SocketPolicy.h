@@ -0,0 +1,143 @@
+/**
+ * @file SocketPolicy.h
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief
+ * @version 0.1
+ * @date 2025-01-09
+ *
+ *
+ */
+
+#pragma once
+#include <xiaoNet/exports.h>
+#include <memory>
+
+namespace xiaoNet
+{
+    /**
+     * @brief The socket options applied to a connection, e.g. by a TcpServer
+     * to every accepted connection. Options that are not set keep the values
+     * of the system.
+     */
+    struct XIAONET_EXPORT SocketPolicy final
+    {
+        /**
+         * @brief Set the SO_BUSY_POLL option: the time to busy poll the
+         * device queue on blocking reads and on polling, in microseconds.
+         * Raising it above the net.core.busy_read sysctl needs the
+         * CAP_NET_ADMIN capability.
+         *
+         * @param usec
+         * @return SocketPolicy&
+         */
+        SocketPolicy &setBusyPoll(int usec)
+        {
+            busyPoll_ = usec;
+            return *this;
+        }
+
+        /**
+         * @brief Set the SO_INCOMING_CPU option. It only matters on listening
+         * sockets sharing a port with SO_REUSEPORT: a new connection goes to
+         * the listener set to the CPU that received it. On a connected socket
+         * the kernel overwrites the value with the CPU handling each received
+         * packet, so it doesn't steer the packets of the connection.
+         *
+         * @param cpu
+         * @return SocketPolicy&
+         */
+        SocketPolicy &setIncomingCpu(int cpu)
+        {
+            incomingCpu_ = cpu;
+            return *this;
+        }
+
+        /**
+         * @brief Set the SO_RCVBUF option, in bytes. The kernel doubles the
+         * value and disables the automatic tuning of the buffer.
+         *
+         * @param bytes
+         * @return SocketPolicy&
+         */
+        SocketPolicy &setRecvBufferSize(int bytes)
+        {
+            recvBufferSize_ = bytes;
+            return *this;
+        }
+
+        /**
+         * @brief Set the SO_SNDBUF option, in bytes. The kernel doubles the
+         * value and disables the automatic tuning of the buffer.
+         *
+         * @param bytes
+         * @return SocketPolicy&
+         */
+        SocketPolicy &setSendBufferSize(int bytes)
+        {
+            sendBufferSize_ = bytes;
+            return *this;
+        }
+
+        /**
+         * @brief Set the TCP_QUICKACK option. The kernel may leave the quick
+         * ack mode on its own later, the option is applied once.
+         *
+         * @param on
+         * @return SocketPolicy&
+         */
+        SocketPolicy &setQuickAck(bool on)
+        {
+            quickAck_ = on ? 1 : 0;
+            return *this;
+        }
+
+        /**
+         * @brief Set the TCP_USER_TIMEOUT option: the time transmitted data
+         * may remain unacknowledged before the connection is closed, in
+         * milliseconds.
+         *
+         * @param ms
+         * @return SocketPolicy&
+         */
+        SocketPolicy &setUserTimeout(unsigned int ms)
+        {
+            userTimeout_ = static_cast<long long>(ms);
+            return *this;
+        }
+
+        // The getters, a negative value means the option is not set.
+        int getBusyPoll() const
+        {
+            return busyPoll_;
+        }
+        int getIncomingCpu() const
+        {
+            return incomingCpu_;
+        }
+        int getRecvBufferSize() const
+        {
+            return recvBufferSize_;
+        }
+        int getSendBufferSize() const
+        {
+            return sendBufferSize_;
+        }
+        int getQuickAck() const
+        {
+            return quickAck_;
+        }
+        long long getUserTimeout() const
+        {
+            return userTimeout_;
+        }
+
+    protected:
+        int busyPoll_ = -1;
+        int incomingCpu_ = -1;
+        int recvBufferSize_ = -1;
+        int sendBufferSize_ = -1;
+        int quickAck_ = -1;
+        long long userTimeout_ = -1;
+    };
+    using SocketPolicyPtr = std::shared_ptr<SocketPolicy>;
+} // namespace xiaoNet
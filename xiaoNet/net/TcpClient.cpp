@@ -149,6 +149,8 @@ void TcpClient::newConnection(int sockfd)
     }
     conn->setConnectionCallback(connectionCallback_);
     conn->setRecvMsgCallback(messageCallback_);
+    if (recvFrameCallback_)
+        conn->setRecvFrameCallback(frameDecoder_, recvFrameCallback_);
     conn->setWriteCompleteCallback(writeCompleteCallback_);
 
     std::weak_ptr<TcpClient> weakSelf(shared_from_this());
@@ -142,6 +142,21 @@ namespace xiaoNet
             messageCallback_ = std::move(cb);
         }
 
+        /**
+         * @brief Set the frame callback, refer to the
+         * TcpConnection::setRecvFrameCallback() method.
+         *
+         * @param decoder
+         * @param cb The callback is called when a complete frame is received from
+         * the server. The message callback is not used if this callback is set.
+         */
+        void setRecvFrameCallback(const LengthFieldDecoder &decoder,
+                                  RecvFrameCallback cb)
+        {
+            frameDecoder_ = decoder;
+            recvFrameCallback_ = std::move(cb);
+        }
+
         /// Set write complete callback.
         /// Not thread safe.
 
@@ -201,6 +216,8 @@ namespace xiaoNet
         ConnectionCallback connectionCallback_;
         ConnectionErrorCallback connectionErrorCallback_;
         RecvMessageCallback messageCallback_;
+        RecvFrameCallback recvFrameCallback_;
+        LengthFieldDecoder frameDecoder_;
         WriteCompleteCallback writeCompleteCallback_;
         SSLErrorCallback sslErrorCallback_;
         std::atomic_bool retry_;
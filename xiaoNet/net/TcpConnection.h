@@ -13,16 +13,30 @@
 #include <xiaoNet/net/EventLoop.h>
 #include <xiaoNet/net/callbacks.h>
 #include <xiaoNet/net/TLSPolicy.h>
+#include <xiaoNet/net/SocketPolicy.h>
 #include <xiaoNet/net/AsyncStream.h>
 #include <xiaoNet/net/Certificate.h>
 #include <xiaoNet/net/InetAddress.h>
+#include <xiaoNet/net/LengthFieldDecoder.h>
 
 #include <memory>
+#include <vector>
 
 namespace xiaoNet
 {
     class TimingWheel;
 
+    /**
+     * @brief A piece of data to send, refer to the
+     * TcpConnection::send(const ConstBuffer *, size_t) method.
+     *
+     */
+    struct ConstBuffer
+    {
+        const void *data;
+        size_t length;
+    };
+
     struct SSLContext;
     using SSLContextPtr = std::shared_ptr<SSLContext>;
 
@@ -55,6 +69,70 @@ namespace xiaoNet
         virtual void send(const std::shared_ptr<std::string> &msgPtr) = 0;
         virtual void send(const std::shared_ptr<MsgBuffer> &msgPtr) = 0;
 
+        /**
+         * @brief Send a control message (a heartbeat, an acknowledgement...)
+         * ahead of the data queued by the other sending methods. The message
+         * is queued right after the node being sent and the control messages
+         * queued before it, so it never splits the data of one send call.
+         * Control messages keep their order among themselves.
+         *
+         * @param msg
+         * @param len
+         * @note To keep the other data flowing, at most 64KB of control
+         * messages jump ahead at a time, until they are sent the next ones
+         * are queued as usual.
+         */
+        virtual void sendControl(const char *msg, size_t len) = 0;
+        void sendControl(const std::string &msg)
+        {
+            sendControl(msg.data(), msg.size());
+        }
+
+        /**
+         * @brief Send several buffers to the peer as if they were one. In the
+         * event loop thread, the buffers are written with one writev() call when
+         * nothing is queued, and only the unwritten part is copied into the send
+         * queue.
+         *
+         * @param buffers
+         * @param count
+         * @note When called from other threads the buffers are copied.
+         */
+        virtual void send(const ConstBuffer *buffers, size_t count) = 0;
+        void send(const std::vector<ConstBuffer> &buffers)
+        {
+            send(buffers.data(), buffers.size());
+        }
+
+        /**
+         * @brief Send up to length bytes read from the file descriptor fd.
+         * The data is moved with splice() through a pipe and never copied
+         * into user space.
+         *
+         * @param fd The source, a file, a pipe or a socket. It must stay
+         * open until the data is sent. Sending stops early at the end of
+         * file or when fd has no more data available.
+         * @param length
+         * @note Only supported on Linux. On TLS connections the data is read
+         * into memory to be encrypted.
+         */
+        virtual void sendFromFd(int fd, size_t length) = 0;
+
+        /**
+         * @brief Forward all data received on this connection to target.
+         * The data is moved from one socket to the other with splice()
+         * through a pipe, it never enters a MsgBuffer. Call forwardTo() on
+         * both connections to build a proxy.
+         *
+         * @param target The connection the data is sent to.
+         * @note Both connections must belong to the same event loop and must
+         * not use TLS. The message callbacks of this connection are no
+         * longer called. Reading is paused while target can't keep up. When
+         * this connection reaches the end of the stream, target is shut
+         * down; if target is closed, this connection is closed as well.
+         */
+        virtual void forwardTo(const TcpConnectionPtr &target) = 0;
+
         /**
          * @brief Send a file to the peer.
          *
@@ -84,11 +162,18 @@ namespace xiaoNet
          * zero size is returned) the callback will be called with nullptr when the
          * send is finished/interrupted, so that it cleans up any internal data (ex:
          * close file).
+         * @param chunkSize The size of the buffer the callback fills. The
+         * buffer is topped up before it is fully drained, so every write
+         * sends at least half a chunk.
+         * @param length The total length of the stream if known, -1 otherwise.
+         * The callback is not asked for more than this.
          * @warning The buffer size should be >= 10 to allow http chunked-encoding data
          * stream
          */
         virtual void sendStream(std::function<std::size_t(char *, std::size_t)>
-                                    callback) = 0;
+                                    callback,
+                                size_t chunkSize = 16 * 1024,
+                                long long length = -1) = 0;
 
         /**
          * @brief Send a stream to the peer asynchronously.
@@ -141,6 +226,28 @@ namespace xiaoNet
         virtual void setHighWaterMarkCallback(const HighWaterMarkCallback &cb,
                                               size_t markLen) = 0;
 
+        /**
+         * @brief Set the Low Water Mark Callback
+         *
+         * @param cb The callback is called when the data in sending buffer
+         * drops to the water mark after being larger than it.
+         * @param markLen
+         */
+        virtual void setLowWaterMarkCallback(const LowWaterMarkCallback &cb,
+                                             size_t markLen) = 0;
+
+        /**
+         * @brief Stop reading from the socket until resumeReading() is
+         * called. The data received meanwhile is kept in the kernel, so the
+         * peer is eventually throttled by TCP flow control.
+         */
+        virtual void pauseReading() = 0;
+
+        /**
+         * @brief Resume reading from the socket.
+         */
+        virtual void resumeReading() = 0;
+
         /**
          * @brief Set the TCP_NODELAY option to the socket.
          *
@@ -148,6 +255,97 @@ namespace xiaoNet
          */
         virtual void setTcpNoDelay(bool on) = 0;
 
+        /**
+         * @brief Set the SO_BUSY_POLL, SO_INCOMING_CPU, SO_RCVBUF, SO_SNDBUF,
+         * TCP_QUICKACK and TCP_USER_TIMEOUT options to the socket, refer to
+         * SocketPolicy for their meaning.
+         *
+         * @return false if the option is not set, e.g. when the platform
+         * doesn't support it.
+         */
+        virtual bool setBusyPoll(int usec) = 0;
+        virtual bool setIncomingCpu(int cpu) = 0;
+        virtual bool setRecvBufferSize(int bytes) = 0;
+        virtual bool setSendBufferSize(int bytes) = 0;
+        virtual bool setQuickAck(bool on) = 0;
+        virtual bool setUserTimeout(unsigned int ms) = 0;
+
+        /**
+         * @brief Set the options of the policy to the socket.
+         *
+         * @param policy
+         */
+        virtual void setSocketPolicy(const SocketPolicy &policy) = 0;
+
+        /**
+         * @brief Enable or disable auto batching of sends.
+         *
+         * @param on If true, data sent in the event loop thread is appended
+         * to the sending buffer instead of being written immediately, and the
+         * buffer is flushed once at the end of the current loop iteration.
+         * Several send() calls made while handling one event then result in
+         * a single write. Disabling the mode flushes pending data.
+         */
+        virtual void setAutoBatch(bool on) = 0;
+
+        /**
+         * @brief Write the data batched in the sending buffer to the socket
+         * now instead of waiting for the end of the loop iteration.
+         *
+         */
+        virtual void flush() = 0;
+
+        /**
+         * @brief Send large buffers with MSG_ZEROCOPY.
+         *
+         * @param threshold Buffers of at least this many bytes are sent
+         * without being copied into the kernel, 0 disables the mode. Only
+         * the overloads of send() that take ownership of the data (rvalue
+         * strings and MsgBuffers, shared pointers) are affected. The memory
+         * is kept alive until the kernel reports the transmission complete,
+         * so the content of a shared buffer must not be modified after it
+         * is sent. Not available on TLS connections or when the kernel
+         * lacks SO_ZEROCOPY support.
+         */
+        virtual void setZeroCopyThreshold(size_t threshold) = 0;
+
+        /**
+         * @brief Read the files and streams passed to sendFile() and
+         * sendStream() in a thread pool, a couple of chunks ahead of the
+         * sending, instead of in the event loop.
+         *
+         * @note Stream callbacks are then called from the pool threads. Files
+         * sent with sendfile() (connections without TLS encryption in user
+         * space) are not affected, the kernel reads them itself.
+         */
+        virtual void setAsyncPrefetch(bool on) = 0;
+
+        /**
+         * @brief Choose the page cache hints issued while the files passed
+         * to sendFile() are sent. It affects the files sent afterwards.
+         *
+         * @param readahead Read the file ahead of the range being sent, on
+         * by default.
+         * @param dropBehind Drop the pages sent from the page cache, off by
+         * default. Only turn it on for large files that are not sent again
+         * soon: the pages are dropped for all the transfers of the file.
+         */
+        virtual void setFileCacheHints(bool readahead, bool dropBehind) = 0;
+
+        /**
+         * @brief Keep the data to send in user space until the kernel is
+         * about to run out of it, using the TCP_NOTSENT_LOWAT socket option.
+         *
+         * @param bytes The socket is reported writable when less than this
+         * many bytes are waiting in the kernel to be sent, and at most this
+         * many bytes are written each time it is. The rest stays in the
+         * sending buffer of the connection, where small messages can still
+         * be coalesced. 0 disables the mode.
+         * @note The data sent with sendFromFd() and forwardTo() is spliced
+         * without the limit.
+         */
+        virtual void setNotSentLowWaterMark(size_t bytes) = 0;
+
         /**
          * @brief Shutdown the connection.
          * @note This method only closes the writing direction.
@@ -244,6 +442,28 @@ namespace xiaoNet
          */
         virtual size_t bytesReceived() const = 0;
 
+        /**
+         * @brief Return the number of bytes in the sending buffer.
+         *
+         * @note Files and streams are counted with their remaining length,
+         * or an estimate when it is unknown. With TLS, the count is
+         * approximate since the bytes written to the socket are encrypted.
+         * @return size_t
+         */
+        virtual size_t bytesQueued() const = 0;
+
+        /**
+         * @brief Return the number of bytes held in memory by the
+         * connection: the received data not consumed yet, the data in the
+         * sending buffer and the TLS buffers.
+         *
+         * @note Files, pipes and streams in the sending buffer are not
+         * counted since they are read when sent, unlike in bytesQueued().
+         *
+         * @return size_t
+         */
+        virtual size_t memoryUsage() const = 0;
+
         /**
          * @brief Check whether the connection is SSL encrypted.
          *
@@ -299,6 +519,25 @@ namespace xiaoNet
         {
             recvMsgCallback_ = std::move(cb);
         }
+        /**
+         * @brief Split the received data into frames by a length field and
+         * deliver each complete frame to the callback. The frames point into the
+         * receive buffer, so no copy is made. The message callback is not called
+         * when a frame callback is set.
+         *
+         * @param decoder Describes the layout of the frames.
+         * @param cb The frame is only valid during the callback. Pass nullptr to
+         * disable framing, also from the frame callback: the data following
+         * the frame then goes to the message callback.
+         * @note The connection is closed when a frame larger than the maximum
+         * frame length or a malformed frame is received.
+         */
+        void setRecvFrameCallback(const LengthFieldDecoder &decoder,
+                                  RecvFrameCallback cb)
+        {
+            frameDecoder_ = decoder;
+            recvFrameCallback_ = std::move(cb);
+        }
         void setConnectionCallback(const ConnectionCallback &cb)
         {
             connectionCallback_ = cb;
@@ -307,6 +546,12 @@ namespace xiaoNet
         {
             connectionCallback_ = std::move(cb);
         }
+        /**
+         * @brief Set the callback called when all the data sent is written to
+         * the socket. It is called in the next loop iteration, after the
+         * events of the other connections of the loop, so sending from it
+         * neither recurses nor starves them.
+         */
         void setWriteCompleteCallback(const WriteCompleteCallback &cb)
         {
             writeCompleteCallback_ = cb;
@@ -340,10 +585,13 @@ namespace xiaoNet
 
     protected:
         RecvMessageCallback recvMsgCallback_;
+        RecvFrameCallback recvFrameCallback_;
+        LengthFieldDecoder frameDecoder_;
         ConnectionCallback connectionCallback_;
         CloseCallback closeCallback_;
         WriteCompleteCallback writeCompleteCallback_;
         HighWaterMarkCallback highWaterMarkCallback_;
+        LowWaterMarkCallback lowWaterMarkCallback_;
         SSLErrorCallback sslErrorCallback_;
         TLSPolicy tlsPolicy_;
 
@@ -12,8 +12,11 @@
 #include <xiaoLog/Logger.h>
 #include <xiaoNet/utils/MsgBuffer.h>
 #include "Acceptor.h"
+#include <algorithm>
 #include <functional>
 #include "inner/TcpConnectionImpl.h"
+#include "inner/TcpConnectionPool.h"
+#include "inner/HotPathLog.h"
 
 using namespace xiaoNet;
 
@@ -30,6 +33,7 @@ TcpServer::TcpServer(EventLoop *loop,
           LOG_ERROR << "unhandled recv message [" << buffer->readableBytes()
                     << " bytes]";
           buffer->retrieveAll(); }),
+      serverMemory_(std::make_shared<std::atomic<size_t>>(0)),
       ioLoops_({loop}),
       numIoLoops_(1)
 {
@@ -41,6 +45,8 @@ TcpServer::TcpServer(EventLoop *loop,
 TcpServer::~TcpServer()
 {
   LOG_TRACE << "TcpServer::~TcpServer [" << serverName_ << "] destructing";
+  if (memoryTimerId_ != InvalidTimerId)
+    loop_->invalidateTimer(memoryTimerId_);
 }
 
 void TcpServer::setBeforeListenSockOptCallback(SockOptCallback cb)
@@ -55,18 +61,29 @@ void TcpServer::setAfterAcceptSockOptCallback(SockOptCallback cb)
 
 void TcpServer::newConnection(int sockfd, const InetAddress &peer)
 {
-  LOG_TRACE << "new connection:fd=" << sockfd
-            << " address=" << peer.toIpPort();
+  LOG_TRACE_HOT << "new connection:fd=" << sockfd
+                << " address=" << peer.toIpPort();
   loop_->assertInLoopThread();
   EventLoop *ioLoop = ioLoops_[nextLoopIdx_];
   if (++nextLoopIdx_ >= numIoLoops_)
   {
     nextLoopIdx_ = 0;
   }
-  TcpConnectionPtr newPtr;
-  if (policyPtr_)
+  assert(!policyPtr_ || sslContextPtr_);
+  std::shared_ptr<TcpConnectionImpl> newPtr;
+  auto pool = connectionPoolMap_.find(ioLoop);
+  if (pool != connectionPoolMap_.end())
+  {
+    newPtr = pool->second->newConnection(ioLoop,
+                                         sockfd,
+                                         InetAddress(
+                                             Socket::getLocalAddr(sockfd)),
+                                         peer,
+                                         policyPtr_,
+                                         sslContextPtr_);
+  }
+  else
   {
-    assert(sslContextPtr_);
     newPtr = std::make_shared<TcpConnectionImpl>(
         ioLoop,
         sockfd,
@@ -75,11 +92,15 @@ void TcpServer::newConnection(int sockfd, const InetAddress &peer)
         policyPtr_,
         sslContextPtr_);
   }
-  else
-  {
-    newPtr = std::make_shared<TcpConnectionImpl>(
-        ioLoop, sockfd, InetAddress(Socket::getLocalAddr(sockfd)), peer);
-  }
+
+  auto loopMemory = loopMemoryMap_.find(ioLoop);
+  newPtr->setMemoryCounters(loopMemory != loopMemoryMap_.end()
+                                ? loopMemory->second
+                                : nullptr,
+                            serverMemory_);
+
+  if (socketPolicyPtr_)
+    newPtr->setSocketPolicy(*socketPolicyPtr_);
 
   if (idleTimeout_ > 0)
   {
@@ -87,7 +108,16 @@ void TcpServer::newConnection(int sockfd, const InetAddress &peer)
     newPtr->enableKickingOff(idleTimeout_, timingWheelMap_[ioLoop]);
   }
 
-  newPtr->setRecvMsgCallback(recvMessageCallback_);
+  // Forward to the callbacks of the server rather than copying them, a
+  // lambda capturing 'this' is stored without allocating.
+  newPtr->setRecvMsgCallback(
+      [this](const TcpConnectionPtr &connectionPtr, MsgBuffer *buffer)
+      { recvMessageCallback_(connectionPtr, buffer); });
+  if (recvFrameCallback_)
+    newPtr->setRecvFrameCallback(
+        frameDecoder_,
+        [this](const TcpConnectionPtr &connectionPtr, const FrameView &frame)
+        { recvFrameCallback_(connectionPtr, frame); });
 
   newPtr->setConnectionCallback(
       [this](const TcpConnectionPtr &connectionPtr)
@@ -95,12 +125,12 @@ void TcpServer::newConnection(int sockfd, const InetAddress &peer)
         if (connectionCallback_)
           connectionCallback_(connectionPtr);
       });
-  newPtr->setWriteCompleteCallback(
-      [this](const TcpConnectionPtr &connectionPtr)
-      {
-        if (writeCompleteCallback_)
-          writeCompleteCallback_(connectionPtr);
-      });
+  // Only set when used, a connection with a write complete callback queues
+  // a task in its loop after each write.
+  if (writeCompleteCallback_)
+    newPtr->setWriteCompleteCallback(
+        [this](const TcpConnectionPtr &connectionPtr)
+        { writeCompleteCallback_(connectionPtr); });
 
   newPtr->setCloseCallback([this](const TcpConnectionPtr &closeConnPtr)
                            { connectionClosed(closeConnPtr); });
@@ -129,11 +159,26 @@ void TcpServer::start()
             }
         }
         LOG_TRACE << "map size=" << timingWheelMap_.size();
+        for (EventLoop *loop : ioLoops_)
+        {
+            loopMemoryMap_[loop] = std::make_shared<std::atomic<size_t>>(0);
+            connectionPoolMap_[loop] = std::make_shared<TcpConnectionPool>();
+        }
+        if (memoryBudget_ > 0)
+        {
+            memoryTimerId_ =
+                loop_->runEvery(0.1, [this]() { enforceMemoryBudget(); });
+        }
         acceptorPtr_->listen(); });
 }
 
 void TcpServer::stop()
 {
+  if (memoryTimerId_ != InvalidTimerId)
+  {
+    loop_->invalidateTimer(memoryTimerId_);
+    memoryTimerId_ = InvalidTimerId;
+  }
   if (loop_->isInLoopThread())
   {
     acceptorPtr_.reset();
@@ -187,6 +232,7 @@ void TcpServer::handleCloseInLoop(const TcpConnectionPtr &connectionPtr)
   size_t n = connSet_.erase(connectionPtr);
   (void)n;
   assert(n == 1);
+  readPausedConns_.erase(connectionPtr);
   auto connLoop = connectionPtr->getLoop();
 
   // NOTE: always queue this operation in connLoop, because this connection
@@ -212,6 +258,89 @@ void TcpServer::connectionClosed(const TcpConnectionPtr &connectionPtr)
   }
 }
 
+void TcpServer::enforceMemoryBudget()
+{
+  loop_->assertInLoopThread();
+  size_t usage = *serverMemory_;
+  // A paused connection resumes once its sending buffer has drained to half
+  // of what it held when paused, whatever the other connections hold.
+  size_t pausedUsage = 0;
+  for (auto iter = readPausedConns_.begin(); iter != readPausedConns_.end();)
+  {
+    auto conn = static_cast<TcpConnectionImpl *>(iter->first.get());
+    auto sendUsage = conn->sendMemoryUsage();
+    if (usage <= memoryBudget_ / 4 * 3 || sendUsage <= iter->second / 2)
+    {
+      conn->setReadingPausedByServer(false);
+      iter = readPausedConns_.erase(iter);
+    }
+    else
+    {
+      pausedUsage += sendUsage;
+      ++iter;
+    }
+  }
+  if (usage <= memoryBudget_)
+    return;
+
+  // The usages keep changing in the I/O threads, sort a snapshot of them.
+  // Pausing reading only stops the sending buffer from growing, the data
+  // already received is only released by the application, so only the
+  // sending buffers are considered unless the connections are closed.
+  std::vector<std::pair<size_t, TcpConnectionPtr>> usages;
+  usages.reserve(connSet_.size());
+  for (auto &conn : connSet_)
+  {
+    auto connUsage =
+        closeLargestConsumers_
+            ? conn->memoryUsage()
+            : static_cast<TcpConnectionImpl *>(conn.get())->sendMemoryUsage();
+    if (connUsage > 0 &&
+        (closeLargestConsumers_ || readPausedConns_.count(conn) == 0))
+      usages.emplace_back(connUsage, conn);
+  }
+  std::sort(usages.begin(),
+            usages.end(),
+            [](const std::pair<size_t, TcpConnectionPtr> &a,
+               const std::pair<size_t, TcpConnectionPtr> &b)
+            { return a.first > b.first; });
+
+  // Shed the largest consumers first until the excess is covered.
+  size_t excess = usage - memoryBudget_;
+  size_t shed = closeLargestConsumers_ ? 0 : pausedUsage;
+  for (auto &entry : usages)
+  {
+    if (shed >= excess)
+      break;
+    shed += entry.first;
+    auto &conn = entry.second;
+    if (closeLargestConsumers_)
+    {
+      LOG_WARN << "Memory budget exceeded, close connection "
+               << conn->peerAddr().toIpPort() << " holding " << entry.first
+               << " bytes";
+      conn->forceClose();
+    }
+    else
+    {
+      LOG_DEBUG << "Memory budget exceeded, pause reading from "
+                << conn->peerAddr().toIpPort() << " holding " << entry.first
+                << " bytes to send";
+      static_cast<TcpConnectionImpl *>(conn.get())
+          ->setReadingPausedByServer(true);
+      readPausedConns_.emplace(conn, entry.first);
+    }
+  }
+}
+
+size_t TcpServer::memoryUsage(EventLoop *ioLoop) const
+{
+  auto iter = loopMemoryMap_.find(ioLoop);
+  if (iter == loopMemoryMap_.end())
+    return 0;
+  return *iter->second;
+}
+
 std::string TcpServer::ipPort() const
 {
   return acceptorPtr_->addr().toIpPort();
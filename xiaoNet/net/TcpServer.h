@@ -17,6 +17,7 @@
 #include <xiaoNet/net/TcpConnection.h>
 #include <xiaoNet/net/EventLoopThreadPool.h>
 #include <xiaoLog/Logger.h>
+#include <atomic>
 #include <csignal>
 #include <set>
 #include <map>
@@ -25,6 +26,7 @@ using namespace xiaoLog;
 namespace xiaoNet
 {
     class Acceptor;
+    class TcpConnectionPool;
 
     /**
      * @brief This class represents a TCP server.
@@ -116,28 +118,55 @@ namespace xiaoNet
          *
          * @param cb The callback is called when some data is received on a
          * connection to the server.
+         * @note The callback must be set before start(): the connections call
+         * it from their I/O threads through the server without copying it.
          */
         void setRecvMessageCallback(const RecvMessageCallback &cb)
         {
+            assert(!started_);
             recvMessageCallback_ = cb;
         }
         void setRecvMessageCallback(RecvMessageCallback &&cb)
         {
+            assert(!started_);
             recvMessageCallback_ = std::move(cb);
         }
 
+        /**
+         * @brief Set the frame callback, refer to the
+         * TcpConnection::setRecvFrameCallback() method.
+         *
+         * @param decoder
+         * @param cb The callback is called when a complete frame is received on a
+         * connection to the server. The message callback is not used if this
+         * callback is set.
+         * @note The callback must be set before start(): the connections call
+         * it from their I/O threads through the server without copying it.
+         */
+        void setRecvFrameCallback(const LengthFieldDecoder &decoder,
+                                  RecvFrameCallback cb)
+        {
+            assert(!started_);
+            frameDecoder_ = decoder;
+            recvFrameCallback_ = std::move(cb);
+        }
+
         /**
          * @brief Set the Connection Callback object
          *
          * @param cb The callback is called when a connection is established or
          * closed.
+         * @note The callback must be set before start(): the connections call
+         * it from their I/O threads through the server without copying it.
          */
         void setConnectionCallback(const ConnectionCallback &cb)
         {
+            assert(!started_);
             connectionCallback_ = cb;
         }
         void setConnectionCallback(ConnectionCallback &&cb)
         {
+            assert(!started_);
             connectionCallback_ = std::move(cb);
         }
 
@@ -146,13 +175,17 @@ namespace xiaoNet
          *
          * @param cb The callback is called when data to send is written to the
          * socket of a connection.
+         * @note The callback must be set before start(): the connections call
+         * it from their I/O threads through the server without copying it.
          */
         void setWriteCompleteCallback(const WriteCompleteCallback &cb)
         {
+            assert(!started_);
             writeCompleteCallback_ = cb;
         }
         void setWriteCompleteCallback(WriteCompleteCallback &&cb)
         {
+            assert(!started_);
             writeCompleteCallback_ = std::move(cb);
         }
 
@@ -169,6 +202,17 @@ namespace xiaoNet
          */
         void setAfterAcceptSockOptCallback(SockOptCallback cb);
 
+        /**
+         * @brief Set the socket options applied to every accepted connection,
+         * after the after accept setsockopt callback is called.
+         *
+         * @param policy
+         */
+        void setSocketPolicy(SocketPolicyPtr policy)
+        {
+            socketPolicyPtr_ = std::move(policy);
+        }
+
         /**
          * @brief Get the name of the server.
          *
@@ -246,10 +290,52 @@ namespace xiaoNet
          */
         void reloadSSL();
 
+        /**
+         * @brief Bound the total number of bytes buffered by the connections
+         * to the server, refer to the TcpConnection::memoryUsage() method.
+         * When the budget is exceeded, the server stops reading from the
+         * connections holding the most data to send, or closes the
+         * connections holding the most memory if closeLargest is true. A
+         * paused connection resumes reading once half of its data to send is
+         * sent, or once the usage drops to three quarters of the budget. The
+         * pauses are independent of TcpConnection::pauseReading(). The usage
+         * is checked every 100ms.
+         *
+         * @param budget The budget in bytes, 0 means no limit.
+         * @param closeLargest
+         */
+        void setMemoryBudget(size_t budget, bool closeLargest = false)
+        {
+            assert(!started_);
+            memoryBudget_ = budget;
+            closeLargestConsumers_ = closeLargest;
+        }
+
+        /**
+         * @brief Get the number of bytes buffered by all connections to the
+         * server.
+         *
+         * @return size_t
+         */
+        size_t memoryUsage() const
+        {
+            return *serverMemory_;
+        }
+
+        /**
+         * @brief Get the number of bytes buffered by the connections handled by
+         * the given I/O loop.
+         *
+         * @param ioLoop
+         * @return size_t
+         */
+        size_t memoryUsage(EventLoop *ioLoop) const;
+
     private:
         void handleCloseInLoop(const TcpConnectionPtr &connectionPtr);
         void newConnection(int fd, const InetAddress &peer);
         void connectionClosed(const TcpConnectionPtr &connectionPtr);
+        void enforceMemoryBudget();
 
         EventLoop *loop_;
         std::unique_ptr<Acceptor> acceptorPtr_;
@@ -257,11 +343,26 @@ namespace xiaoNet
         std::set<TcpConnectionPtr> connSet_;
 
         RecvMessageCallback recvMessageCallback_;
+        RecvFrameCallback recvFrameCallback_;
+        LengthFieldDecoder frameDecoder_;
         ConnectionCallback connectionCallback_;
         WriteCompleteCallback writeCompleteCallback_;
 
         size_t idleTimeout_{0};
         std::map<EventLoop *, std::shared_ptr<TimingWheel>> timingWheelMap_;
+        // Recycles the memory of closed connections, one per I/O loop.
+        std::map<EventLoop *, std::shared_ptr<TcpConnectionPool>>
+            connectionPoolMap_;
+
+        size_t memoryBudget_{0};
+        bool closeLargestConsumers_{false};
+        std::shared_ptr<std::atomic<size_t>> serverMemory_;
+        std::map<EventLoop *, std::shared_ptr<std::atomic<size_t>>>
+            loopMemoryMap_;
+        // The connections paused for the budget, with the bytes they had to
+        // send when paused.
+        std::map<TcpConnectionPtr, size_t> readPausedConns_;
+        TimerId memoryTimerId_{InvalidTimerId};
 
         // 'loopPoolPtr_' may and may not hold the internal thread pool.
         // We should not access it directly in codes.
@@ -288,6 +389,7 @@ namespace xiaoNet
 #endif
         bool started_{false};
         TLSPolicyPtr policyPtr_{nullptr};
+        SocketPolicyPtr socketPolicyPtr_{nullptr};
         SSLContextPtr sslContextPtr_{nullptr};
     };
 }
\ No newline at end of file
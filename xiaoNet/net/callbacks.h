@@ -24,15 +24,20 @@ namespace xiaoNet
 
     class TcpConnection;
     class MsgBuffer;
+    struct FrameView;
     using TcpConnectionPtr = std::shared_ptr<TcpConnection>;
     using RecvMessageCallback =
         std::function<void(const TcpConnectionPtr &, MsgBuffer *)>;
+    using RecvFrameCallback =
+        std::function<void(const TcpConnectionPtr &, const FrameView &)>;
     using ConnectionErrorCallback = std::function<void()>;
     using ConnectionCallback = std::function<void(const TcpConnectionPtr &)>;
     using CloseCallback = std::function<void(const TcpConnectionPtr &)>;
     using WriteCompleteCallback = std::function<void(const TcpConnectionPtr &)>;
     using HighWaterMarkCallback =
         std::function<void(const TcpConnectionPtr &, const size_t)>;
+    using LowWaterMarkCallback =
+        std::function<void(const TcpConnectionPtr &, const size_t)>;
     using SSLErrorCallback = std::function<void(SSLError)>;
     using SockOptCallback = std::function<void(int)>;
 }
\ No newline at end of file
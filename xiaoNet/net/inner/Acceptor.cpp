@@ -9,6 +9,7 @@
  */
 
 #include "Acceptor.h"
+#include "HotPathLog.h"
 using namespace xiaoNet;
 
 #ifndef O_CLOEXEC
@@ -60,10 +61,10 @@ void Acceptor::listen()
 
 void Acceptor::readCallback()
 {
-    LOG_DEBUG << "Acceptor::readCallback called";
+    LOG_DEBUG_HOT << "Acceptor::readCallback called";
     InetAddress peer;
     int newsock = sock_.accept(&peer);
-    LOG_DEBUG << newsock;
+    LOG_DEBUG_HOT << newsock;
     if (newsock >= 0)
     {
         if (afterAcceptSetSockOptCallback_)
@@ -9,27 +9,25 @@
  */
 
 #include <xiaoNet/net/inner/BufferNode.h>
+#include <deque>
+#include <string>
 
 namespace xiaoNet
 {
+    // Copied data is gathered into chunks of up to this size.
+    static const size_t kMaxCoalescedChunkSize = 64 * 1024;
+
     class AsyncBufferNode : public BufferNode
     {
     public:
-        AsyncBufferNode() = default;
-        ~AsyncBufferNode() override = default;
-        bool isAsync() const override
+        explicit AsyncBufferNode(std::function<void(size_t)> &&drainCallback)
+            : BufferNode(kAsyncStream), drainCallback_(std::move(drainCallback))
         {
-            return true;
-        }
-        bool isStream() const override
-        {
-            return true;
         }
+        ~AsyncBufferNode() override = default;
         long long remainingBytes() const override
         {
-            if (msgBufferPtr_)
-                return static_cast<long long>(msgBufferPtr_->readableBytes());
-            return 0;
+            return static_cast<long long>(size_);
         }
         bool available() const override
         {
@@ -37,10 +35,10 @@ namespace xiaoNet
         }
         void getData(const char *&data, size_t &len) override
         {
-            if (msgBufferPtr_)
+            if (!chunks_.empty())
             {
-                data = msgBufferPtr_->peek();
-                len = msgBufferPtr_->readableBytes();
+                data = chunks_.front().data() + frontOffset_;
+                len = chunks_.front().size() - frontOffset_;
             }
             else
             {
@@ -50,26 +48,44 @@ namespace xiaoNet
         }
         void retrieve(size_t len) override
         {
-            assert(msgBufferPtr_);
-            if (msgBufferPtr_)
+            assert(len <= size_);
+            size_ -= len;
+            frontOffset_ += len;
+            while (!chunks_.empty() && frontOffset_ >= chunks_.front().size())
             {
-                msgBufferPtr_->retrieve(len);
+                frontOffset_ -= chunks_.front().size();
+                chunks_.pop_front();
             }
+            if (drainCallback_)
+                drainCallback_(len);
         }
         void append(const char *data, size_t len) override
         {
-            if (!msgBufferPtr_)
-            {
-                msgBufferPtr_ = std::make_unique<MsgBuffer>(len);
-            }
-            msgBufferPtr_->append(data, len);
+            if (!chunks_.empty() &&
+                chunks_.back().size() + len <= kMaxCoalescedChunkSize)
+                chunks_.back().append(data, len);
+            else
+                chunks_.emplace_back(data, len);
+            size_ += len;
+        }
+        void append(std::string &&data) override
+        {
+            if (data.empty())
+                return;
+            size_ += data.size();
+            chunks_.push_back(std::move(data));
         }
 
     private:
-        std::unique_ptr<MsgBuffer> msgBufferPtr_;
+        std::deque<std::string> chunks_;
+        // The bytes of the front chunk already sent.
+        size_t frontOffset_{0};
+        size_t size_{0};
+        std::function<void(size_t)> drainCallback_;
     };
-    BufferNodePtr BufferNode::newAsyncStreamBufferNode()
+    BufferNodePtr BufferNode::newAsyncStreamBufferNode(
+        std::function<void(size_t)> &&drainCallback)
     {
-        return std::make_shared<AsyncBufferNode>();
+        return std::make_shared<AsyncBufferNode>(std::move(drainCallback));
     }
-}
\ No newline at end of file
+}
@@ -27,54 +27,167 @@ namespace xiaoNet
     class BufferNode : public NonCopyable
     {
     public:
-        virtual bool isFile() const
+        /**
+         * @brief The kind of a node. The write path tests it instead of
+         * calling virtual methods, and calls the methods of memory nodes
+         * directly (see MemBufferNode.h).
+         */
+        enum Kind : uint8_t
         {
-            return false;
+            kMemory,
+            kFile,
+            kStream,
+            kAsyncStream,
+            kPrefetch,
+            kZeroCopy,
+            kPipe
+        };
+        Kind kind() const
+        {
+            return kind_;
+        }
+        bool isMemory() const
+        {
+            return kind_ == kMemory;
+        }
+        bool isFile() const
+        {
+            return kind_ == kFile;
         }
         virtual ~BufferNode() = default;
-        virtual bool isStream() const
+        bool isStream() const
         {
-            return false;
+            return kind_ == kStream || isAsync();
         }
         virtual void getData(const char *&data, size_t &len) = 0;
         virtual void append(const char *, size_t)
         {
             LOG_FATAL << "Not a memeory buffer node";
         }
+        virtual void append(std::string &&data)
+        {
+            append(data.data(), data.size());
+        }
         virtual void retrieve(size_t len) = 0;
         virtual long long remainingBytes() const = 0;
         virtual int getFd() const
         {
             LOG_FATAL << "Not a file buffer node";
         }
+        virtual long long fileOffset() const
+        {
+            LOG_FATAL << "Not a file buffer node";
+            return 0;
+        }
         virtual bool available() const
         {
             return true;
         }
-        virtual bool isAsync() const
+        bool isAsync() const
         {
-            return false;
+            return kind_ == kAsyncStream || kind_ == kPrefetch;
+        }
+        bool isZeroCopy() const
+        {
+            return kind_ == kZeroCopy;
+        }
+        bool isPipe() const
+        {
+            return kind_ == kPipe;
+        }
+        virtual ssize_t spliceTo(int)
+        {
+            LOG_FATAL << "Not a pipe buffer node";
+            return -1;
         }
 
         void done()
         {
             isDone_ = true;
         }
+        /**
+         * @brief Create a memory node. Nodes are taken from a pool of the
+         * calling thread when possible.
+         */
         static BufferNodePtr newMemBufferNode();
+        /**
+         * @brief Give a drained memory node back to the pool of the calling
+         * thread. The node must have been created by newMemBufferNode().
+         */
+        static void recycleMemBufferNode(BufferNodePtr &&node);
 
-        static BufferNodePtr newStreamBufferNode(StreamCallback &&cb);
+        /**
+         * @brief Create a node pulling data from cb in chunks of chunkSize
+         * bytes. If length is not negative, it's the total length of the
+         * stream.
+         */
+        static BufferNodePtr newStreamBufferNode(StreamCallback &&cb,
+                                                 size_t chunkSize = 16 * 1024,
+                                                 long long length = -1);
+        /**
+         * @brief The page cache hints issued by a file node while it's sent,
+         * combined with bitwise or.
+         */
+        enum FileHints : uint8_t
+        {
+            kNoFileHints = 0,
+            // Read ahead of the range being sent.
+            kFileReadahead = 1,
+            // Drop the pages sent from the page cache, for files that are not
+            // sent again soon.
+            kFileDropBehind = 2
+        };
 #ifdef _WIN32
         static BufferNodePtr newFileBufferNode(const wchar_t *fileName,
                                                long long offset,
-                                               long long length);
+                                               long long length,
+                                               uint8_t hints = kFileReadahead);
 #else
         static BufferNodePtr newFileBufferNode(const char *fileName,
                                                long long offset,
-                                               long long length);
+                                               long long length,
+                                               uint8_t hints = kFileReadahead);
+#endif
+        /**
+         * @brief Create the node of an async stream. drainCallback is called
+         * with the number of bytes each time some are retrieved.
+         */
+        static BufferNodePtr newAsyncStreamBufferNode(
+            std::function<void(size_t)> &&drainCallback = nullptr);
+#ifdef __linux__
+        /**
+         * @brief Create a node sending up to length bytes read from fd with
+         * splice() through a pipe. If takeNow is true, the available bytes
+         * are moved into the pipe immediately and the node is detached from
+         * fd.
+         */
+        static BufferNodePtr newPipeBufferNode(int fd,
+                                               size_t length,
+                                               bool takeNow = false);
 #endif
-        static BufferNodePtr newAsyncStreamBufferNode();
+        /**
+         * @brief Create a node referencing len bytes at data without copying
+         * them. The owner keeps the memory alive as long as the node lives.
+         */
+        static BufferNodePtr newZeroCopyBufferNode(std::shared_ptr<void> &&owner,
+                                                   const char *data,
+                                                   size_t len);
+        /**
+         * @brief Create a node producing the data of source (a file or stream
+         * node) in a worker thread, a couple of chunks ahead of the sending.
+         * onReady is called from the worker thread when a chunk is ready.
+         */
+        static BufferNodePtr newPrefetchBufferNode(
+            BufferNodePtr &&source,
+            std::function<void()> &&onReady);
 
     protected:
+        explicit BufferNode(Kind kind) : kind_(kind)
+        {
+        }
         bool isDone_{false};
+
+    private:
+        const Kind kind_;
     };
 }
@@ -0,0 +1,102 @@
+/**
+ * @file BufferNodeQueue.h
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief
+ * @version 0.1
+ * @date 2025-01-11
+ *
+ *
+ */
+
+#pragma once
+
+#include <xiaoNet/net/inner/BufferNode.h>
+#include <xiaoNet/utils/NonCopyable.h>
+#include <cassert>
+#include <memory>
+
+namespace xiaoNet
+{
+    /**
+     * @brief The queue of the nodes waiting to be sent on a connection.
+     * It's a ring buffer whose first slots are stored inline, so queuing a
+     * node doesn't allocate unless many nodes are pending.
+     */
+    class BufferNodeQueue : public NonCopyable
+    {
+    public:
+        BufferNodeQueue() = default;
+
+        bool empty() const
+        {
+            return size_ == 0;
+        }
+        size_t size() const
+        {
+            return size_;
+        }
+        BufferNodePtr &front()
+        {
+            assert(size_ > 0);
+            return slots_[head_];
+        }
+        BufferNodePtr &back()
+        {
+            assert(size_ > 0);
+            return (*this)[size_ - 1];
+        }
+        BufferNodePtr &operator[](size_t index)
+        {
+            assert(index < size_);
+            return slots_[(head_ + index) & (capacity_ - 1)];
+        }
+        void push_back(BufferNodePtr &&node)
+        {
+            if (size_ == capacity_)
+                grow();
+            slots_[(head_ + size_) & (capacity_ - 1)] = std::move(node);
+            ++size_;
+        }
+        void push_back(const BufferNodePtr &node)
+        {
+            push_back(BufferNodePtr(node));
+        }
+        // Insert before the node at index, the following nodes are shifted.
+        void insert(size_t index, BufferNodePtr &&node)
+        {
+            assert(index <= size_);
+            push_back(std::move(node));
+            for (size_t i = size_ - 1; i > index; --i)
+                (*this)[i].swap((*this)[i - 1]);
+        }
+        void pop_front()
+        {
+            assert(size_ > 0);
+            slots_[head_].reset();
+            head_ = (head_ + 1) & (capacity_ - 1);
+            --size_;
+        }
+
+    private:
+        void grow()
+        {
+            // The capacity stays a power of 2.
+            auto capacity = capacity_ * 2;
+            std::unique_ptr<BufferNodePtr[]> slots(new BufferNodePtr[capacity]);
+            for (size_t i = 0; i < size_; ++i)
+                slots[i] = std::move((*this)[i]);
+            heapSlots_ = std::move(slots);
+            slots_ = heapSlots_.get();
+            capacity_ = capacity;
+            head_ = 0;
+        }
+
+        static constexpr size_t kInlineCapacity = 4;
+        BufferNodePtr inlineSlots_[kInlineCapacity];
+        std::unique_ptr<BufferNodePtr[]> heapSlots_;
+        BufferNodePtr *slots_{inlineSlots_};
+        size_t capacity_{kInlineCapacity};
+        size_t head_{0};
+        size_t size_{0};
+    };
+}
@@ -9,18 +9,43 @@
  */
 
 #include <xiaoNet/net/inner/BufferNode.h>
+#include <xiaoNet/net/FileCache.h>
+#include <xiaoNet/utils/SerialTaskQueue.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <algorithm>
 
 namespace xiaoNet
 {
     static const size_t kMaxSendFileBufferSize = 16 * 1024;
+    // Files are mapped in windows of this size, smaller files are mapped
+    // entirely.
+    static const size_t kMmapWindowSize = 4 * 1024 * 1024;
+    // The part of the file ahead of the cursor that is read ahead.
+    static const long long kReadaheadWindow = 2 * 1024 * 1024;
+    // With kFileDropBehind, the pages behind the cursor are dropped from the
+    // page cache in chunks of this size.
+    static const long long kDropBehindChunk = 8 * 1024 * 1024;
+
+    // Page cache hints may block on IO, they are issued in this queue so
+    // that the event loops never wait for them.
+    static SerialTaskQueue &fileHintQueue()
+    {
+        // Never destroyed, hints may still be queued at exit.
+        static auto queue = new SerialTaskQueue("FileHintQueue");
+        return *queue;
+    }
+
     class FileBufferNode : public BufferNode
     {
     public:
-        FileBufferNode(const char *fileName, long long offset, long long length)
+        FileBufferNode(const char *fileName,
+                       long long offset,
+                       long long length,
+                       uint8_t hints)
+            : BufferNode(kFile), hints_(hints)
         {
             assert(offset >= 0);
             if (offset < 0)
@@ -29,23 +54,16 @@ namespace xiaoNet
                 isDone_ = true;
                 return;
             }
-            sendFd_ = open(fileName, O_RDONLY);
-
-            if (sendFd_ < 0)
+            // The open file is shared with the other transfers of the same
+            // path, only explicit offsets are used with it.
+            file_ = FileCache::instance().open(fileName);
+            if (!file_)
             {
                 LOG_SYSERR << fileName << " open error";
                 isDone_ = true;
                 return;
             }
-            struct stat filestat;
-            if (stat(fileName, &filestat) < 0)
-            {
-                LOG_SYSERR << fileName << " stat error";
-                close(sendFd_);
-                sendFd_ = -1;
-                isDone_ = true;
-                return;
-            }
+            const struct stat &filestat = file_->fileStat();
             if (length == 0)
             {
                 if (offset > filestat.st_size)
@@ -53,8 +71,7 @@ namespace xiaoNet
                     LOG_ERROR << "The file size is " << filestat.st_size
                               << " bytes, but the offset is " << offset
                               << " byte and the length is " << length << " bytes";
-                    close(sendFd_);
-                    sendFd_ = -1;
+                    file_.reset();
                     isDone_ = true;
                     return;
                 }
@@ -67,25 +84,48 @@ namespace xiaoNet
                     LOG_ERROR << "The file size is " << filestat.st_size
                               << " bytes, but the offset is " << offset
                               << " bytes and the length is " << length << " bytes";
-                    close(sendFd_);
-                    sendFd_ = -1;
+                    file_.reset();
                     isDone_ = true;
                     return;
                 }
                 fileBytesToSend_ = length;
             }
-            lseek(sendFd_, offset, SEEK_SET);
+            fileOffset_ = offset;
+            readaheadOffset_ = offset;
+            dropOffset_ = offset;
+#ifdef POSIX_FADV_SEQUENTIAL
+            if (hints_ & kFileReadahead)
+                posix_fadvise(file_->fd(),
+                              offset,
+                              fileBytesToSend_,
+                              POSIX_FADV_SEQUENTIAL);
+#endif
+            adviseAhead();
         }
-        bool isFile() const override
+        int getFd() const override
         {
-            return true;
+            return file_ ? file_->fd() : -1;
         }
-        int getFd() const override
+        long long fileOffset() const override
         {
-            return sendFd_;
+            return fileOffset_;
         }
         void getData(const char *&data, size_t &len) override
         {
+            // Expose the mapped pages directly, fall back to read() if the
+            // file can't be mapped.
+            if (useMmap_ && fileBytesToSend_ > 0 && file_)
+            {
+                if (mapWindow())
+                {
+                    auto pos = static_cast<size_t>(fileOffset_ - mapOffset_);
+                    data = static_cast<const char *>(mapAddr_) + pos;
+                    len = (std::min)(mapLength_ - pos,
+                                     static_cast<size_t>(fileBytesToSend_));
+                    return;
+                }
+                useMmap_ = false;
+            }
             if (msgBufferPtr_ == nullptr)
             {
                 msgBufferPtr_ = std::make_unique<MsgBuffer>(
@@ -93,14 +133,15 @@ namespace xiaoNet
                                static_cast<size_t>(fileBytesToSend_)));
             }
             if (msgBufferPtr_->readableBytes() == 0 && fileBytesToSend_ > 0 &&
-                sendFd_ >= 0)
+                file_)
             {
                 msgBufferPtr_->ensureWritableBytes(
                     (std::min)(kMaxSendFileBufferSize,
                                static_cast<size_t>(fileBytesToSend_)));
-                auto n = read(sendFd_,
-                              msgBufferPtr_->beginWrite(),
-                              msgBufferPtr_->writableBytes());
+                auto n = pread(file_->fd(),
+                               msgBufferPtr_->beginWrite(),
+                               msgBufferPtr_->writableBytes(),
+                               fileOffset_);
                 if (n > 0)
                 {
                     msgBufferPtr_->hasWritten(n);
@@ -123,9 +164,11 @@ namespace xiaoNet
             {
                 msgBufferPtr_->retrieve(len);
             }
+            fileOffset_ += static_cast<long long>(len);
             fileBytesToSend_ -= static_cast<long long>(len);
             if (fileBytesToSend_ < 0)
                 fileBytesToSend_ = 0;
+            adviseAhead();
         }
         long long remainingBytes() const override
         {
@@ -135,26 +178,119 @@ namespace xiaoNet
         }
         ~FileBufferNode() override
         {
-            if (sendFd_ >= 0)
-            {
-                close(sendFd_);
-            }
+            if (mapAddr_)
+                munmap(mapAddr_, mapLength_);
         }
         bool available() const override
         {
-            return sendFd_ >= 0;
+            return file_ != nullptr;
         }
 
     private:
-        int sendFd_{-1};
+        // Keep the range in front of the cursor being read ahead and drop
+        // the pages behind it, as requested by the hints. The file may be
+        // shared with other transfers, the pages are only dropped when the
+        // sender knows the file isn't hot.
+        void adviseAhead()
+        {
+            if (!file_)
+                return;
+            auto end = fileOffset_ + fileBytesToSend_;
+            if ((hints_ & kFileReadahead) && readaheadOffset_ < end &&
+                readaheadOffset_ - fileOffset_ < kReadaheadWindow / 2)
+            {
+                auto from = (std::max)(readaheadOffset_, fileOffset_);
+                auto len = (std::min)(kReadaheadWindow, end - from);
+                readaheadOffset_ = from + len;
+                fileHintQueue().runTaskInQueue([file = file_, from, len]() {
+#ifdef __linux__
+                    readahead(file->fd(), from, static_cast<size_t>(len));
+#elif defined(POSIX_FADV_WILLNEED)
+                    posix_fadvise(file->fd(), from, len, POSIX_FADV_WILLNEED);
+#endif
+                });
+            }
+#ifdef POSIX_FADV_DONTNEED
+            if ((hints_ & kFileDropBehind) &&
+                fileOffset_ - dropOffset_ >= kDropBehindChunk)
+            {
+                auto from = dropOffset_;
+                auto len = fileOffset_ - dropOffset_;
+                dropOffset_ = fileOffset_;
+                fileHintQueue().runTaskInQueue([file = file_, from, len]() {
+                    posix_fadvise(file->fd(), from, len, POSIX_FADV_DONTNEED);
+                });
+            }
+#endif
+        }
+
+        // Make sure the window mapped contains the current offset.
+        bool mapWindow()
+        {
+            if (mapAddr_ && fileOffset_ >= mapOffset_ &&
+                fileOffset_ < mapOffset_ + static_cast<long long>(mapLength_))
+                return true;
+            if (mapAddr_)
+            {
+                munmap(mapAddr_, mapLength_);
+                mapAddr_ = nullptr;
+            }
+            // Reading a mapping past the end of the file raises SIGBUS, don't
+            // map a file truncated since it was opened.
+            struct stat filestat;
+            if (fstat(file_->fd(), &filestat) != 0)
+            {
+                LOG_SYSERR << "fstat error, fall back to read()";
+                return false;
+            }
+            if (filestat.st_size < fileOffset_ + fileBytesToSend_)
+            {
+                LOG_WARN << "The file was truncated to " << filestat.st_size
+                         << " bytes while being sent, fall back to read()";
+                return false;
+            }
+            static const long long pageSize = sysconf(_SC_PAGESIZE);
+            mapOffset_ = fileOffset_ - fileOffset_ % pageSize;
+            mapLength_ = (std::min)(
+                kMmapWindowSize,
+                static_cast<size_t>(fileOffset_ + fileBytesToSend_ -
+                                    mapOffset_));
+            auto addr = mmap(
+                nullptr, mapLength_, PROT_READ, MAP_SHARED, file_->fd(), mapOffset_);
+            if (addr == MAP_FAILED)
+            {
+                LOG_SYSERR << "mmap error, fall back to read()";
+                return false;
+            }
+            madvise(addr, mapLength_, MADV_SEQUENTIAL);
+            mapAddr_ = addr;
+            return true;
+        }
+
+        CachedFilePtr file_;
+        const uint8_t hints_;
         long long fileBytesToSend_{0};
+        long long fileOffset_{0};
+        // The end of the range already read ahead
+        long long readaheadOffset_{0};
+        // The start of the range not dropped from the page cache yet
+        long long dropOffset_{0};
         std::unique_ptr<MsgBuffer> msgBufferPtr_;
+        // The size of the file is checked before each window is mapped.
+        bool useMmap_{true};
+        void *mapAddr_{nullptr};
+        long long mapOffset_{0};
+        size_t mapLength_{0};
     };
 
     BufferNodePtr BufferNode::newFileBufferNode(const char *fileName,
                                                 long long offset,
-                                                long long length)
+                                                long long length,
+                                                uint8_t hints)
     {
-        return std::make_shared<FileBufferNode>(fileName, offset, length);
+        return std::make_shared<FileBufferNode>(fileName,
+                                                offset,
+                                                length,
+                                                hints);
     }
 }
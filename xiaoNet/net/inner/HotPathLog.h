@@ -0,0 +1,32 @@
+/**
+ * @file HotPathLog.h
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief
+ * @version 0.1
+ * @date 2025-01-10
+ *
+ *
+ */
+
+#pragma once
+
+#include <xiaoLog/Logger.h>
+
+/**
+ * @brief Logging for the paths run per event or per message (polling,
+ * dispatching, reading, writing and queueing functions). Unless the library is
+ * built with the XIAONET_HOT_PATH_LOGGING option, these statements compile to
+ * nothing: neither the log level is checked nor the arguments are evaluated.
+ * The arguments are still type checked.
+ */
+#ifdef XIAONET_HOT_PATH_LOGGING
+#define LOG_TRACE_HOT LOG_TRACE
+#define LOG_DEBUG_HOT LOG_DEBUG
+#else
+#define LOG_TRACE_HOT \
+    while (false)     \
+    LOG_TRACE
+#define LOG_DEBUG_HOT \
+    while (false)     \
+    LOG_DEBUG
+#endif
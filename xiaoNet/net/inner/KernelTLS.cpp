@@ -0,0 +1,152 @@
+/**
+ * @file KernelTLS.cpp
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief
+ * @version 0.1
+ * @date 2025-01-11
+ *
+ *
+ */
+
+#include <xiaoNet/net/inner/KernelTLS.h>
+#include <xiaoLog/Logger.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <linux/tls.h>
+#include <string.h>
+
+#ifndef SOL_TLS
+#define SOL_TLS 282
+#endif
+
+using namespace xiaoNet;
+
+namespace
+{
+    template <typename Info>
+    bool fillCryptoInfo(Info &info, const KernelTLSKeys &keys)
+    {
+        if (keys.key.size() != sizeof(info.key) ||
+            keys.iv.size() != sizeof(info.iv) ||
+            keys.salt.size() != sizeof(info.salt) ||
+            keys.recordSequence.size() != sizeof(info.rec_seq))
+        {
+            LOG_ERROR << "Invalid kernel TLS key sizes";
+            return false;
+        }
+        memset(&info, 0, sizeof(info));
+        info.info.version = keys.version;
+        info.info.cipher_type = keys.cipher;
+        memcpy(info.key, keys.key.data(), sizeof(info.key));
+        memcpy(info.iv, keys.iv.data(), sizeof(info.iv));
+        memcpy(info.salt, keys.salt.data(), sizeof(info.salt));
+        memcpy(info.rec_seq,
+               keys.recordSequence.data(),
+               sizeof(info.rec_seq));
+        return true;
+    }
+
+    template <typename Info>
+    bool setCryptoInfo(int fd, int direction, const KernelTLSKeys &keys)
+    {
+        Info info;
+        if (!fillCryptoInfo(info, keys))
+            return false;
+        auto ret = ::setsockopt(fd, SOL_TLS, direction, &info, sizeof(info));
+        memset(&info, 0, sizeof(info));
+        if (ret < 0)
+        {
+            LOG_SYSERR << "Failed to set kernel TLS keys";
+            return false;
+        }
+        return true;
+    }
+}  // namespace
+
+constexpr uint8_t KernelTLS::kRecordAlert;
+constexpr uint8_t KernelTLS::kRecordHandshake;
+constexpr uint8_t KernelTLS::kRecordApplicationData;
+constexpr uint8_t KernelTLS::kHandshakeNewSessionTicket;
+constexpr uint8_t KernelTLS::kHandshakeKeyUpdate;
+
+bool KernelTLS::enable(int fd)
+{
+    if (::setsockopt(fd, SOL_TCP, TCP_ULP, "tls", sizeof("tls")) < 0)
+    {
+        LOG_TRACE << "kernel TLS is not available, errno=" << errno;
+        return false;
+    }
+    return true;
+}
+
+bool KernelTLS::setKeys(int fd, bool transmit, const KernelTLSKeys &keys)
+{
+    int direction = transmit ? TLS_TX : TLS_RX;
+    switch (keys.cipher)
+    {
+        case TLS_CIPHER_AES_GCM_128:
+            return setCryptoInfo<tls12_crypto_info_aes_gcm_128>(fd,
+                                                                direction,
+                                                                keys);
+        case TLS_CIPHER_AES_GCM_256:
+            return setCryptoInfo<tls12_crypto_info_aes_gcm_256>(fd,
+                                                                direction,
+                                                                keys);
+#ifdef TLS_CIPHER_CHACHA20_POLY1305
+        case TLS_CIPHER_CHACHA20_POLY1305:
+            return setCryptoInfo<tls12_crypto_info_chacha20_poly1305>(
+                fd, direction, keys);
+#endif
+        default:
+            LOG_ERROR << "Cipher " << keys.cipher
+                      << " is not supported by kernel TLS";
+            return false;
+    }
+}
+
+ssize_t KernelTLS::sendRecord(int fd,
+                              uint8_t type,
+                              const void *data,
+                              size_t len)
+{
+    char control[CMSG_SPACE(sizeof(type))];
+    struct iovec vec;
+    vec.iov_base = const_cast<void *>(data);
+    vec.iov_len = len;
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &vec;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    auto cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_TLS;
+    cmsg->cmsg_type = TLS_SET_RECORD_TYPE;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(type));
+    memcpy(CMSG_DATA(cmsg), &type, sizeof(type));
+    return ::sendmsg(fd, &msg, 0);
+}
+
+ssize_t KernelTLS::recvRecord(int fd, uint8_t &type, void *data, size_t len)
+{
+    char control[CMSG_SPACE(sizeof(type))];
+    struct iovec vec;
+    vec.iov_base = data;
+    vec.iov_len = len;
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &vec;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    auto n = ::recvmsg(fd, &msg, 0);
+    if (n < 0)
+        return n;
+    type = kRecordApplicationData;
+    auto cmsg = CMSG_FIRSTHDR(&msg);
+    if (cmsg && cmsg->cmsg_level == SOL_TLS &&
+        cmsg->cmsg_type == TLS_GET_RECORD_TYPE)
+        type = *CMSG_DATA(cmsg);
+    return n;
+}
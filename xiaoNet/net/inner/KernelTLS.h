@@ -0,0 +1,80 @@
+/**
+ * @file KernelTLS.h
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief
+ * @version 0.1
+ * @date 2025-01-11
+ *
+ *
+ */
+
+#pragma once
+
+#include <xiaoNet/exports.h>
+#include <string>
+#include <stdint.h>
+#include <sys/types.h>
+
+namespace xiaoNet
+{
+    /**
+     * @brief The traffic keys of one direction of a TLS session, in the
+     * layout expected by the kernel (see linux/tls.h).
+     *
+     */
+    struct KernelTLSKeys
+    {
+        // TLS_1_2_VERSION or TLS_1_3_VERSION
+        uint16_t version{0};
+        // TLS_CIPHER_AES_GCM_128, TLS_CIPHER_AES_GCM_256 or
+        // TLS_CIPHER_CHACHA20_POLY1305, 0 if the keys are not set.
+        uint16_t cipher{0};
+        std::string key;
+        std::string iv;
+        std::string salt;
+        std::string recordSequence;
+    };
+
+    /**
+     * @brief Helpers to hand the record layer of an established TLS session
+     * over to the kernel (kTLS). Once the keys are set, plain write(),
+     * sendfile() and read() calls on the socket carry encrypted records.
+     *
+     */
+    class XIAONET_EXPORT KernelTLS
+    {
+    public:
+        /**
+         * @brief Attach the "tls" upper layer protocol to a connected TCP
+         * socket. Return false if the kernel does not support kTLS.
+         */
+        static bool enable(int fd);
+
+        /**
+         * @brief Set the keys used to encrypt (transmit is true) or decrypt
+         * the records of the socket.
+         */
+        static bool setKeys(int fd, bool transmit, const KernelTLSKeys &keys);
+
+        /**
+         * @brief Send a record of the given content type, e.g. an alert.
+         */
+        static ssize_t sendRecord(int fd,
+                                  uint8_t type,
+                                  const void *data,
+                                  size_t len);
+
+        /**
+         * @brief Receive a record, used when read() fails with EIO because
+         * the next record is not application data.
+         */
+        static ssize_t recvRecord(int fd, uint8_t &type, void *data, size_t len);
+
+        static constexpr uint8_t kRecordAlert = 21;
+        static constexpr uint8_t kRecordHandshake = 22;
+        static constexpr uint8_t kRecordApplicationData = 23;
+        // Types of the post handshake messages of handshake records.
+        static constexpr uint8_t kHandshakeNewSessionTicket = 4;
+        static constexpr uint8_t kHandshakeKeyUpdate = 24;
+    };
+}
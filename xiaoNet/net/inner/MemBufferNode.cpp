@@ -8,40 +8,54 @@
  *
  */
 
-#include <xiaoNet/net/inner/BufferNode.h>
+#include <xiaoNet/net/inner/MemBufferNode.h>
+#include <vector>
 
 namespace xiaoNet
 {
-    class MemBufferNode : public BufferNode
+    // Nodes whose buffer grew larger than this get a new buffer when
+    // recycled, so that the pool doesn't hold on to large buffers.
+    static const size_t kMaxPooledBufferSize = 16 * 1024;
+    static const size_t kMaxPooledNodes = 64;
+
+    void MemBufferNode::reset()
     {
-    public:
-        MemBufferNode() = default;
+        if (peakBytes_ > kMaxPooledBufferSize)
+            MsgBuffer().swap(buffer_);
+        else
+            buffer_.retrieveAll();
+        peakBytes_ = 0;
+        isDone_ = false;
+    }
 
-        void getData(const char *&data, size_t &len) override
-        {
-            data = buffer_.peek();
-            len = buffer_.readableBytes();
-        }
-        void retrieve(size_t len) override
-        {
-            buffer_.retrieve(len);
-        }
-        long long remainingBytes() const override
-        {
-            if (isDone_)
-                return 0;
-            return static_cast<long long>(buffer_.readableBytes());
-        }
-        void append(const char *data, size_t len) override
-        {
-            buffer_.append(data, len);
-        }
+    // Every event loop thread keeps its own pool of free nodes.
+    static std::vector<std::shared_ptr<MemBufferNode>> &memBufferNodePool()
+    {
+        thread_local std::vector<std::shared_ptr<MemBufferNode>> pool;
+        return pool;
+    }
 
-    private:
-        xiaoNet::MsgBuffer buffer_;
-    };
     BufferNodePtr BufferNode::newMemBufferNode()
     {
-        return std::make_shared<MemBufferNode>();
+        auto &pool = memBufferNodePool();
+        if (pool.empty())
+            return std::make_shared<MemBufferNode>();
+        auto node = std::move(pool.back());
+        pool.pop_back();
+        return node;
+    }
+    void BufferNode::recycleMemBufferNode(BufferNodePtr &&node)
+    {
+        assert(node->isMemory());
+        auto &pool = memBufferNodePool();
+        // The node may still be referenced, e.g. by a queued task.
+        if (node.use_count() != 1 || pool.size() >= kMaxPooledNodes)
+        {
+            node.reset();
+            return;
+        }
+        auto memNode = std::static_pointer_cast<MemBufferNode>(std::move(node));
+        memNode->reset();
+        pool.push_back(std::move(memNode));
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,68 @@
+/**
+ * @file MemBufferNode.h
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief
+ * @version 0.1
+ * @date 2025-01-11
+ *
+ *
+ */
+
+#pragma once
+
+#include <xiaoNet/net/inner/BufferNode.h>
+
+namespace xiaoNet
+{
+    /**
+     * @brief The node holding a copy of the data sent. It's final and defined
+     * in a header so that the write path, having checked the kind of a node,
+     * calls its methods directly (and inlined) through a MemBufferNode
+     * pointer.
+     */
+    class MemBufferNode final : public BufferNode
+    {
+    public:
+        MemBufferNode() : BufferNode(kMemory)
+        {
+        }
+
+        void getData(const char *&data, size_t &len) override
+        {
+            data = buffer_.peek();
+            len = buffer_.readableBytes();
+        }
+        void retrieve(size_t len) override
+        {
+            buffer_.retrieve(len);
+        }
+        long long remainingBytes() const override
+        {
+            if (isDone_)
+                return 0;
+            return static_cast<long long>(buffer_.readableBytes());
+        }
+        void append(const char *data, size_t len) override
+        {
+            buffer_.append(data, len);
+            if (buffer_.readableBytes() > peakBytes_)
+                peakBytes_ = buffer_.readableBytes();
+        }
+        using BufferNode::append;
+        // Empty the node before it is pooled.
+        void reset();
+
+    private:
+        xiaoNet::MsgBuffer buffer_;
+        size_t peakBytes_{0};
+    };
+
+    // Memory nodes are by far the most common, test for them first.
+    inline long long remainingBytesOf(const BufferNodePtr &node)
+    {
+        if (node->isMemory())
+            return static_cast<const MemBufferNode *>(node.get())
+                ->remainingBytes();
+        return node->remainingBytes();
+    }
+}
@@ -0,0 +1,211 @@
+/**
+ * @file PipeBufferNode.cpp
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief
+ * @version 0.1
+ * @date 2025-01-11
+ *
+ *
+ */
+
+#include <xiaoNet/net/inner/BufferNode.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <vector>
+#include <algorithm>
+
+namespace xiaoNet
+{
+    static const size_t kMaxPooledPipes = 16;
+    static const size_t kMaxReadBufferSize = 16 * 1024;
+
+    // Pipes are only used in the event loop thread that owns the connection,
+    // so a thread local pool is a per-loop pool.
+    class PipePool
+    {
+    public:
+        ~PipePool()
+        {
+            for (auto &p : pipes_)
+            {
+                ::close(p.first);
+                ::close(p.second);
+            }
+        }
+        bool acquire(int &readFd, int &writeFd)
+        {
+            if (!pipes_.empty())
+            {
+                readFd = pipes_.back().first;
+                writeFd = pipes_.back().second;
+                pipes_.pop_back();
+                return true;
+            }
+            int fds[2];
+            if (::pipe2(fds, O_NONBLOCK | O_CLOEXEC) < 0)
+            {
+                LOG_SYSERR << "pipe2 error";
+                return false;
+            }
+            readFd = fds[0];
+            writeFd = fds[1];
+            return true;
+        }
+        // Only empty pipes can be reused.
+        void release(int readFd, int writeFd, bool empty)
+        {
+            if (empty && pipes_.size() < kMaxPooledPipes)
+            {
+                pipes_.emplace_back(readFd, writeFd);
+                return;
+            }
+            ::close(readFd);
+            ::close(writeFd);
+        }
+        static PipePool &instance()
+        {
+            static thread_local PipePool pool;
+            return pool;
+        }
+
+    private:
+        std::vector<std::pair<int, int>> pipes_;
+    };
+
+    class PipeBufferNode : public BufferNode
+    {
+    public:
+        PipeBufferNode(int fd, size_t length, bool takeNow)
+            : BufferNode(kPipe), srcFd_(fd), srcRemaining_(length)
+        {
+            if (takeNow)
+            {
+                if (fill() < 0 && errno != EAGAIN)
+                    LOG_SYSERR << "splice from fd " << fd << " error";
+                // Only the bytes moved into the pipe belong to this node.
+                srcRemaining_ = 0;
+            }
+        }
+        ~PipeBufferNode() override
+        {
+            if (pipeReadFd_ >= 0)
+                PipePool::instance().release(pipeReadFd_,
+                                             pipeWriteFd_,
+                                             pipeBytes_ == 0);
+        }
+        int getFd() const override
+        {
+            return pipeReadFd_;
+        }
+        long long remainingBytes() const override
+        {
+            if (isDone_)
+                return 0;
+            return static_cast<long long>(srcRemaining_ + pipeBytes_ +
+                                          buffer_.readableBytes());
+        }
+        ssize_t spliceTo(int fd) override
+        {
+            ssize_t hasSent = 0;
+            while (remainingBytes() > 0)
+            {
+                if (pipeBytes_ == 0)
+                {
+                    auto n = fill();
+                    if (n <= 0)
+                    {
+                        // End of file or no more data available in the source.
+                        if (n < 0 && errno != EAGAIN)
+                            LOG_SYSERR << "splice from fd " << srcFd_
+                                       << " error";
+                        isDone_ = true;
+                        break;
+                    }
+                }
+                auto n = ::splice(pipeReadFd_,
+                                  nullptr,
+                                  fd,
+                                  nullptr,
+                                  pipeBytes_,
+                                  SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+                if (n < 0)
+                {
+                    if (hasSent == 0)
+                        return -1;
+                    break;
+                }
+                pipeBytes_ -= n;
+                hasSent += n;
+            }
+            return hasSent;
+        }
+        void getData(const char *&data, size_t &len) override
+        {
+            // Used by TLS connections which need the data in user space.
+            if (buffer_.readableBytes() == 0)
+            {
+                int fd = pipeBytes_ > 0 ? pipeReadFd_ : srcFd_;
+                size_t toRead = pipeBytes_ > 0 ? pipeBytes_ : srcRemaining_;
+                buffer_.ensureWritableBytes(
+                    std::min(toRead, kMaxReadBufferSize));
+                auto n = ::read(fd,
+                                buffer_.beginWrite(),
+                                std::min(toRead, buffer_.writableBytes()));
+                if (n > 0)
+                {
+                    buffer_.hasWritten(n);
+                    if (fd == pipeReadFd_)
+                        pipeBytes_ -= n;
+                    else
+                        srcRemaining_ -= n;
+                }
+                else
+                {
+                    isDone_ = true;
+                }
+            }
+            data = buffer_.peek();
+            len = buffer_.readableBytes();
+        }
+        void retrieve(size_t len) override
+        {
+            buffer_.retrieve(len);
+        }
+
+    private:
+        // Move data from the source into the pipe.
+        ssize_t fill()
+        {
+            if (srcRemaining_ == 0)
+                return 0;
+            if (pipeReadFd_ < 0 &&
+                !PipePool::instance().acquire(pipeReadFd_, pipeWriteFd_))
+                return -1;
+            auto n = ::splice(srcFd_,
+                              nullptr,
+                              pipeWriteFd_,
+                              nullptr,
+                              srcRemaining_,
+                              SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            if (n > 0)
+            {
+                srcRemaining_ -= n;
+                pipeBytes_ += n;
+            }
+            return n;
+        }
+
+        int srcFd_;
+        size_t srcRemaining_;
+        int pipeReadFd_{-1};
+        int pipeWriteFd_{-1};
+        size_t pipeBytes_{0};
+        MsgBuffer buffer_;
+    };
+    BufferNodePtr BufferNode::newPipeBufferNode(int fd,
+                                                size_t length,
+                                                bool takeNow)
+    {
+        return std::make_shared<PipeBufferNode>(fd, length, takeNow);
+    }
+}
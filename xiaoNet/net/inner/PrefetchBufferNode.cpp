@@ -0,0 +1,152 @@
+/**
+ * @file PrefetchBufferNode.cpp
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief
+ * @version 0.1
+ * @date 2025-01-11
+ *
+ *
+ */
+
+#include <xiaoNet/net/inner/BufferNode.h>
+#include <xiaoNet/utils/ConcurrentTaskQueue.h>
+#include <algorithm>
+#include <cassert>
+#include <deque>
+#include <mutex>
+
+namespace xiaoNet
+{
+    static const size_t kPrefetchChunkSize = 64 * 1024;
+    // At most this many chunks are produced ahead of the sending.
+    static const size_t kMaxPrefetchedChunks = 2;
+
+    static ConcurrentTaskQueue &prefetchQueue()
+    {
+        // Never destroyed, chunks may still be produced at exit.
+        static auto queue = new ConcurrentTaskQueue(4, "PrefetchQueue");
+        return *queue;
+    }
+
+    // Produces the data of a file or stream node in a ConcurrentTaskQueue so
+    // that blocking reads and stream callbacks don't run in the event loop.
+    // The node behaves as an async node: when no chunk is ready it has no
+    // remaining bytes but is still available, and onReady is called (in a
+    // worker thread) when the next chunk is.
+    class PrefetchBufferNode
+        : public BufferNode,
+          public std::enable_shared_from_this<PrefetchBufferNode>
+    {
+    public:
+        PrefetchBufferNode(BufferNodePtr &&source,
+                           std::function<void()> &&onReady)
+            : BufferNode(kPrefetch),
+              source_(std::move(source)),
+              onReady_(std::move(onReady))
+        {
+        }
+        bool available() const override
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return !sourceDone_ || !chunks_.empty();
+        }
+        long long remainingBytes() const override
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (chunks_.empty())
+                return 0;
+            return static_cast<long long>(chunks_.front().readableBytes());
+        }
+        void getData(const char *&data, size_t &len) override
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (chunks_.empty())
+            {
+                data = nullptr;
+                len = 0;
+                return;
+            }
+            // The front chunk is only modified in the loop thread.
+            data = chunks_.front().peek();
+            len = chunks_.front().readableBytes();
+        }
+        void retrieve(size_t len) override
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                assert(!chunks_.empty());
+                chunks_.front().retrieve(len);
+                if (chunks_.front().readableBytes() > 0)
+                    return;
+                chunks_.pop_front();
+            }
+            prefetch();
+        }
+        void prefetch()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (producing_ || sourceDone_ ||
+                    chunks_.size() >= kMaxPrefetchedChunks)
+                    return;
+                producing_ = true;
+            }
+            prefetchQueue().runTaskInQueue(
+                [thisPtr = shared_from_this()]() { thisPtr->produce(); });
+        }
+
+    private:
+        void produce()
+        {
+            MsgBuffer chunk(kPrefetchChunkSize);
+            bool done = false;
+            while (chunk.readableBytes() < kPrefetchChunkSize)
+            {
+                if (source_->remainingBytes() <= 0)
+                {
+                    done = true;
+                    break;
+                }
+                const char *data;
+                size_t len;
+                source_->getData(data, len);
+                if (len == 0)
+                {
+                    done = true;
+                    break;
+                }
+                len = (std::min)(len, kPrefetchChunkSize - chunk.readableBytes());
+                chunk.append(data, len);
+                source_->retrieve(len);
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (chunk.readableBytes() > 0)
+                    chunks_.push_back(std::move(chunk));
+                sourceDone_ = done;
+                producing_ = false;
+            }
+            if (done)
+                source_.reset();
+            prefetch();
+            onReady_();
+        }
+
+        BufferNodePtr source_;
+        std::function<void()> onReady_;
+        mutable std::mutex mutex_;
+        std::deque<MsgBuffer> chunks_;
+        bool producing_{false};
+        bool sourceDone_{false};
+    };
+
+    BufferNodePtr BufferNode::newPrefetchBufferNode(
+        BufferNodePtr &&source,
+        std::function<void()> &&onReady)
+    {
+        auto node = std::make_shared<PrefetchBufferNode>(std::move(source),
+                                                         std::move(onReady));
+        node->prefetch();
+        return node;
+    }
+}
@@ -10,6 +10,8 @@
 
 #include <xiaoLog/Logger.h>
 #include "Socket.h"
+#include "HotPathLog.h"
+#include <climits>
 #ifdef _WIN32
 #else
 #include <sys/socket.h>
@@ -18,6 +20,30 @@
 
 using namespace xiaoNet;
 
+static bool setIntOption(int fd,
+                         int level,
+                         int option,
+                         int optval,
+                         const char *optionName)
+{
+#ifdef _WIN32
+    int ret = ::setsockopt(fd,
+                           level,
+                           option,
+                           reinterpret_cast<const char *>(&optval),
+                           static_cast<socklen_t>(sizeof optval));
+#else
+    int ret = ::setsockopt(
+        fd, level, option, &optval, static_cast<socklen_t>(sizeof optval));
+#endif
+    if (ret < 0)
+    {
+        LOG_SYSERR << optionName << " failed.";
+        return false;
+    }
+    return true;
+}
+
 bool Socket::isSelfConnect(int sockfd)
 {
     struct sockaddr_in6 localaddr = getLocalAddr(sockfd);
@@ -210,6 +236,126 @@ void Socket::setKeepAlive(bool on)
                  static_cast<socklen_t>(sizeof optval));
 }
 
+bool Socket::setZeroCopy(bool on)
+{
+#ifdef SO_ZEROCOPY
+    int optval = on ? 1 : 0;
+    int ret = ::setsockopt(sockFd_,
+                           SOL_SOCKET,
+                           SO_ZEROCOPY,
+                           &optval,
+                           static_cast<socklen_t>(sizeof optval));
+    if (ret < 0 && on)
+    {
+        LOG_SYSERR << "SO_ZEROCOPY failed.";
+        return false;
+    }
+    return true;
+#else
+    (void)on;
+    return false;
+#endif
+}
+
+bool Socket::setNotSentLowWaterMark(size_t bytes)
+{
+#ifdef TCP_NOTSENT_LOWAT
+    unsigned int optval =
+        bytes > 0 && bytes < UINT_MAX ? static_cast<unsigned int>(bytes)
+                                      : UINT_MAX;
+    int ret = ::setsockopt(sockFd_,
+                           IPPROTO_TCP,
+                           TCP_NOTSENT_LOWAT,
+                           &optval,
+                           static_cast<socklen_t>(sizeof optval));
+    if (ret < 0)
+    {
+        LOG_SYSERR << "TCP_NOTSENT_LOWAT failed.";
+        return false;
+    }
+    return true;
+#else
+    (void)bytes;
+    return false;
+#endif
+}
+
+bool Socket::setBusyPoll(int usec)
+{
+#ifdef SO_BUSY_POLL
+    return setIntOption(sockFd_, SOL_SOCKET, SO_BUSY_POLL, usec, "SO_BUSY_POLL");
+#else
+    (void)usec;
+    LOG_ERROR << "SO_BUSY_POLL is not supported.";
+    return false;
+#endif
+}
+
+bool Socket::setIncomingCpu(int cpu)
+{
+#ifdef SO_INCOMING_CPU
+    return setIntOption(
+        sockFd_, SOL_SOCKET, SO_INCOMING_CPU, cpu, "SO_INCOMING_CPU");
+#else
+    (void)cpu;
+    LOG_ERROR << "SO_INCOMING_CPU is not supported.";
+    return false;
+#endif
+}
+
+bool Socket::setRecvBufferSize(int bytes)
+{
+    return setIntOption(sockFd_, SOL_SOCKET, SO_RCVBUF, bytes, "SO_RCVBUF");
+}
+
+bool Socket::setSendBufferSize(int bytes)
+{
+    return setIntOption(sockFd_, SOL_SOCKET, SO_SNDBUF, bytes, "SO_SNDBUF");
+}
+
+bool Socket::setQuickAck(bool on)
+{
+#ifdef TCP_QUICKACK
+    return setIntOption(
+        sockFd_, IPPROTO_TCP, TCP_QUICKACK, on ? 1 : 0, "TCP_QUICKACK");
+#else
+    (void)on;
+    LOG_ERROR << "TCP_QUICKACK is not supported.";
+    return false;
+#endif
+}
+
+bool Socket::setUserTimeout(unsigned int ms)
+{
+#ifdef TCP_USER_TIMEOUT
+    return setIntOption(sockFd_,
+                        IPPROTO_TCP,
+                        TCP_USER_TIMEOUT,
+                        static_cast<int>(ms),
+                        "TCP_USER_TIMEOUT");
+#else
+    (void)ms;
+    LOG_ERROR << "TCP_USER_TIMEOUT is not supported.";
+    return false;
+#endif
+}
+
+void Socket::applyPolicy(const SocketPolicy &policy)
+{
+    if (policy.getBusyPoll() >= 0)
+        setBusyPoll(policy.getBusyPoll());
+    if (policy.getIncomingCpu() >= 0)
+        setIncomingCpu(policy.getIncomingCpu());
+    if (policy.getRecvBufferSize() >= 0)
+        setRecvBufferSize(policy.getRecvBufferSize());
+    if (policy.getSendBufferSize() >= 0)
+        setSendBufferSize(policy.getSendBufferSize());
+    if (policy.getQuickAck() >= 0)
+        setQuickAck(policy.getQuickAck() != 0);
+    if (policy.getUserTimeout() >= 0)
+        setUserTimeout(static_cast<unsigned int>(policy.getUserTimeout()));
+}
+
 int Socket::getSocketError()
 {
 #ifdef _WIN32
@@ -235,7 +381,7 @@ int Socket::getSocketError()
 
 Socket::~Socket()
 {
-    LOG_TRACE << "Socket decontructed:" << sockFd_;
+    LOG_TRACE_HOT << "Socket decontructed:" << sockFd_;
     if (sockFd_ >= 0)
 #ifndef _WIN32
         close(sockFd_);
@@ -12,6 +12,7 @@
 
 #include <xiaoNet/utils/NonCopyable.h>
 #include <xiaoNet/net/InetAddress.h>
+#include <xiaoNet/net/SocketPolicy.h>
 #include <xiaoLog/Logger.h>
 #ifndef _WIN32
 #include <unistd.h>
@@ -102,6 +103,37 @@ namespace xiaoNet
         void setReusePort(bool on);
 
         void setKeepAlive(bool on);
+
+        /**
+         * @brief Set the SO_ZEROCOPY option, return false if the kernel does
+         * not support it.
+         */
+        bool setZeroCopy(bool on);
+
+        /**
+         * @brief Set the TCP_NOTSENT_LOWAT option, 0 restores the default (no
+         * limit). Return false if the kernel does not support it.
+         */
+        bool setNotSentLowWaterMark(size_t bytes);
+
+        /**
+         * @brief Set the SO_BUSY_POLL, SO_INCOMING_CPU, SO_RCVBUF, SO_SNDBUF,
+         * TCP_QUICKACK and TCP_USER_TIMEOUT options, refer to SocketPolicy.
+         * Return false if the option is not set, e.g. when the platform
+         * doesn't support it.
+         */
+        bool setBusyPoll(int usec);
+        bool setIncomingCpu(int cpu);
+        bool setRecvBufferSize(int bytes);
+        bool setSendBufferSize(int bytes);
+        bool setQuickAck(bool on);
+        bool setUserTimeout(unsigned int ms);
+
+        /**
+         * @brief Set the options of the policy, except the incoming CPU of the
+         * event loop which is set by the connection.
+         */
+        void applyPolicy(const SocketPolicy &policy);
         int getSocketError();
 
     protected:
@@ -9,36 +9,30 @@
  */
 
 #include <xiaoNet/net/inner/BufferNode.h>
+#include <algorithm>
 
 namespace xiaoNet
 {
-    static const size_t kMaxSendFileBufferSize = 16 * 1024;
     class StreamBufferNode : public BufferNode
     {
     public:
-        StreamBufferNode(std::function<std::size_t(char *, std::size_t)> &&callback)
-            : streamCallback_(std::move(callback))
+        StreamBufferNode(std::function<std::size_t(char *, std::size_t)> &&callback,
+                         size_t chunkSize,
+                         long long length)
+            : BufferNode(kStream),
+              streamCallback_(std::move(callback)),
+              chunkSize_(chunkSize > 0 ? chunkSize : 1),
+              length_(length),
+              msgBuffer_(chunkSize_)
         {
         }
-        bool isStream() const override
-        {
-            return true;
-        }
         void getData(const char *&data, size_t &len) override
         {
-            if (msgBuffer_.readableBytes() == 0)
+            // Top the chunk up once half of it is drained, so that the next
+            // chunk is filled while the current one is still being sent.
+            if (!isDone_ && msgBuffer_.readableBytes() <= chunkSize_ / 2)
             {
-                msgBuffer_.ensureWritableBytes(kMaxSendFileBufferSize);
-                auto n = streamCallback_(msgBuffer_.beginWrite(),
-                                         msgBuffer_.writableBytes());
-                if (n > 0)
-                {
-                    msgBuffer_.hasWritten(n);
-                }
-                else
-                {
-                    isDone_ = true;
-                }
+                fill();
             }
             data = msgBuffer_.peek();
             len = msgBuffer_.readableBytes();
@@ -54,9 +48,13 @@ namespace xiaoNet
         }
         long long remainingBytes() const override
         {
+            auto buffered = static_cast<long long>(msgBuffer_.readableBytes());
             if (isDone_)
-                return 0;
-            return 1;
+                return buffered;
+            if (length_ >= 0)
+                return buffered + length_ - produced_;
+            // The length is unknown, at least one more byte may follow.
+            return buffered + 1;
         }
         ~StreamBufferNode() override
         {
@@ -65,14 +63,46 @@ namespace xiaoNet
         }
 
     private:
+        void fill()
+        {
+            size_t toRead = chunkSize_ - msgBuffer_.readableBytes();
+            if (length_ >= 0)
+                toRead = (std::min)(toRead,
+                                    static_cast<size_t>(length_ - produced_));
+            if (toRead == 0)
+            {
+                isDone_ = true;
+                return;
+            }
+            msgBuffer_.ensureWritableBytes(toRead);
+            auto n = streamCallback_(msgBuffer_.beginWrite(), toRead);
+            if (n > 0)
+            {
+                msgBuffer_.hasWritten(n);
+                produced_ += static_cast<long long>(n);
+            }
+            else
+            {
+                isDone_ = true;
+            }
+        }
+
         std::function<std::size_t(char *, std::size_t)> streamCallback_;
+        size_t chunkSize_;
+        // The total length of the stream, -1 if unknown.
+        long long length_;
+        long long produced_{0};
 #ifndef NDEBUG
         std::size_t dataWritten_{0};
 #endif
         MsgBuffer msgBuffer_;
     };
-    BufferNodePtr BufferNode::newStreamBufferNode(StreamCallback &&callback)
+    BufferNodePtr BufferNode::newStreamBufferNode(StreamCallback &&callback,
+                                                  size_t chunkSize,
+                                                  long long length)
     {
-        return std::make_shared<StreamBufferNode>(std::move(callback));
+        return std::make_shared<StreamBufferNode>(std::move(callback),
+                                                  chunkSize,
+                                                  length);
     }
-}
\ No newline at end of file
+}
@@ -14,6 +14,7 @@
 #include <xiaoNet/utils/MsgBuffer.h>
 #include <xiaoNet/net/TcpConnection.h>
 #include <xiaoNet/net/callbacks.h>
+#include <xiaoNet/net/inner/KernelTLS.h>
 #include <xiaoLog/Logger.h>
 
 namespace xiaoNet
@@ -58,6 +59,38 @@ namespace xiaoNet
 
         virtual void startEncryption() = 0;
 
+        /**
+         * @brief Check whether exportKernelTLSKeys() is supported for the
+         * session, without changing its state.
+         */
+        virtual bool canExportKernelTLSKeys() const
+        {
+            return false;
+        }
+
+        /**
+         * @brief Export the traffic keys of the established session so that
+         * the kernel can take over the record layer (kTLS).
+         *
+         * @param tx The keys and the next record sequence number used to
+         * encrypt outgoing records, nullptr to keep encrypting in user space.
+         * @param rx The keys used to decrypt incoming records, nullptr to
+         * keep decrypting in user space.
+         * The provider leaves the cipher of a direction at 0 when it can't
+         * export it.
+         * @return false if the provider can't export its keys, the session
+         * then stays in user space.
+         * @note After a successful export the provider is no longer used to
+         * encrypt or decrypt data in the exported directions. Only request
+         * the directions the kernel is ready to take over.
+         */
+        virtual bool exportKernelTLSKeys(KernelTLSKeys *tx, KernelTLSKeys *rx)
+        {
+            (void)tx;
+            (void)rx;
+            return false;
+        }
+
         bool sendBufferedData()
         {
             if (writeBuffer_.readableBytes() == 0)
@@ -9,18 +9,28 @@
  */
 
 #include "TcpConnectionImpl.h"
+#include "MemBufferNode.h"
+#include "HotPathLog.h"
 #include "Socket.h"
 #include "Channel.h"
 #include <xiaoNet/utils/Utilities.h>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
 #include <stdexcept>
 
 #ifdef __linux__
 #include <sys/sendfile.h>
+#include <sys/ioctl.h>
+#include <xiaoNet/net/inner/KernelTLS.h>
 #include <poll.h>
+#include <linux/errqueue.h>
 #endif
 #include <sys/types.h>
 #ifndef _WIN32
 #include <unistd.h>
+#include <sys/uio.h>
+#include <limits.h>
 #endif
 
 using namespace xiaoNet;
@@ -29,7 +39,7 @@ static inline bool isEAGAIN()
 {
     if (errno == EWOULDBLOCK || errno == EAGAIN || errno == 0)
     {
-        LOG_TRACE << "write buffer is full";
+        LOG_TRACE_HOT << "write buffer is full";
         return true;
     }
     else if (errno == EPIPE || errno == ECONNRESET)
@@ -49,30 +59,57 @@ static inline bool isEAGAIN()
     }
 }
 
+// Memory and zero copy nodes reference their data, async streams keep the
+// chunks pushed by the application. The other nodes read a file, a pipe or
+// a callback when sent.
+static inline bool holdsDataInMemory(const BufferNode &node)
+{
+    return node.isMemory() || node.isZeroCopy() ||
+           node.kind() == BufferNode::kAsyncStream;
+}
+
+
+TcpConnectionImpl::TcpConnectionImpl(EventLoop *loop,
+                                     int socketfd,
+                                     const InetAddress &localAddr,
+                                     const InetAddress &peerAddr,
+                                     TLSPolicyPtr policy,
+                                     SSLContextPtr ctx)
+    : TcpConnectionImpl(loop,
+                        socketfd,
+                        localAddr,
+                        peerAddr,
+                        MsgBuffer(),
+                        std::move(policy),
+                        std::move(ctx))
+{
+}
+
 TcpConnectionImpl::TcpConnectionImpl(EventLoop *loop,
                                      int socketfd,
                                      const InetAddress &localAddr,
                                      const InetAddress &peerAddr,
+                                     MsgBuffer &&readBuffer,
                                      TLSPolicyPtr policy,
                                      SSLContextPtr ctx)
     : loop_(loop),
-      ioChannelPtr_(new Channel(loop, socketfd)),
-      socketPtr_(new Socket(socketfd)),
+      ioChannel_(loop, socketfd),
+      socket_(socketfd),
+      readBuffer_(std::move(readBuffer)),
       localAddr_(localAddr),
       peerAddr_(peerAddr)
 {
-    LOG_TRACE << "new connection:" << peerAddr.toIpPort() << "->"
-              << localAddr.toIpPort();
-    ioChannelPtr_->setReadCallback([this]()
+    LOG_TRACE_HOT << "new connection:" << peerAddr.toIpPort() << "->"
+                  << localAddr.toIpPort();
+    ioChannel_.setReadCallback([this]()
                                    { readCallback(); });
-    ioChannelPtr_->setWriteCallback([this]()
+    ioChannel_.setWriteCallback([this]()
                                     { writeCallback(); });
-    ioChannelPtr_->setCloseCallback([this]()
+    ioChannel_.setCloseCallback([this]()
                                     { handleClose(); });
-    ioChannelPtr_->setErrorCallback([this]()
+    ioChannel_.setErrorCallback([this]()
                                     { handleError(); });
-    socketPtr_->setKeepAlive(true);
-    name_ = localAddr.toIpPort() + "--" + peerAddr.toIpPort();
+    socket_.setKeepAlive(true);
 
     if (policy != nullptr)
     {
@@ -85,7 +122,7 @@ TcpConnectionImpl::TcpConnectionImpl(EventLoop *loop,
         // This is triggered when peer sends a close alert
         tlsProviderPtr_->setCloseCallback(onSslCloseAlert);
     }
-    LOG_DEBUG << "END";
+    LOG_DEBUG_HOT << "END";
 }
 
 TcpConnectionImpl::~TcpConnectionImpl()
@@ -114,15 +151,37 @@ TcpConnectionImpl::~TcpConnectionImpl()
     }
     // send a close alert to peer if we are still connected
     if (tlsProviderPtr_ && status_ == ConnStatus::Connected)
-        tlsProviderPtr_->close();
+        closeTLS();
+    setMemoryUsage(0, 0);
+}
+
+const std::string &TcpConnectionImpl::name()
+{
+    if (name_.empty())
+        name_ = localAddr_.toIpPort() + "--" + peerAddr_.toIpPort();
+    return name_;
 }
 
 void TcpConnectionImpl::readCallback()
 {
     loop_->assertInLoopThread();
+    if (!forwardTarget_.expired())
+    {
+        forwardInLoop();
+        return;
+    }
     int ret = 0;
 
-    ssize_t n = readBuffer_.readFd(socketPtr_->fd(), &ret);
+    ssize_t n = readBuffer_.readFd(socket_.fd(), &ret);
+#ifdef __linux__
+    // The next record is not application data.
+    if (n < 0 && errno == EIO && kernelTLSRx_)
+    {
+        if (!readKernelTLSRecord())
+            handleClose();
+        return;
+    }
+#endif
     if (n == 0)
     {
         handleClose();
@@ -133,10 +192,10 @@ void TcpConnectionImpl::readCallback()
         {
 #ifdef _WIN32
             LOG_TRACE << "WSAENOTCONN or WSAECONNRESET, errno=" << errno
-                      << " fd=" << socketPtr_->fd();
+                      << " fd=" << socket_.fd();
 #else
             LOG_TRACE << "EPIPE or ECONNRESET, errno=" << errno
-                      << " fd=" << socketPtr_->fd();
+                      << " fd=" << socket_.fd();
 #endif
             return;
         }
@@ -150,8 +209,8 @@ void TcpConnectionImpl::readCallback()
 #else
         if (errno == EAGAIN) // TODO: any others?
         {
-            LOG_TRACE << "EAGAIN, errno=" << errno
-                      << " fd=" << socketPtr_->fd();
+            LOG_TRACE_HOT << "EAGAIN, errno=" << errno
+                          << " fd=" << socket_.fd();
             return;
         }
 #endif
@@ -163,16 +222,57 @@ void TcpConnectionImpl::readCallback()
     if (n > 0)
     {
         bytesReceived_ += n;
-        if (tlsProviderPtr_)
+        if (tlsProviderPtr_ && !kernelTLSRx_)
         {
             tlsProviderPtr_->recvData(&readBuffer_);
         }
-        else if (recvMsgCallback_)
+        else
         {
-            recvMsgCallback_(shared_from_this(), &readBuffer_);
+            handleRecvData(&readBuffer_);
         }
+        updateMemoryUsage();
     }
 }
+void TcpConnectionImpl::handleRecvData(MsgBuffer *buffer)
+{
+    if (!recvFrameCallback_)
+    {
+        if (recvMsgCallback_)
+            recvMsgCallback_(shared_from_this(), buffer);
+        return;
+    }
+    auto thisPtr = shared_from_this();
+    FrameView frame;
+    size_t frameLength;
+    // A frame callback may disable framing or replace the callback.
+    while (recvFrameCallback_ && status_ != ConnStatus::Disconnected)
+    {
+        auto status = frameDecoder_.decode(*buffer, frame, frameLength);
+        if (status == FrameStatus::kComplete)
+        {
+            recvFrameCallback_(thisPtr, frame);
+            buffer->retrieve(frameLength);
+        }
+        else if (status == FrameStatus::kNeedMore)
+        {
+            break;
+        }
+        else
+        {
+            LOG_ERROR << "[" << name() << "] - "
+                      << (status == FrameStatus::kTooLarge
+                              ? "frame is too large"
+                              : "malformed frame")
+                      << ", close the connection";
+            buffer->retrieveAll();
+            forceClose();
+            break;
+        }
+    }
+    if (!recvFrameCallback_ && recvMsgCallback_ &&
+        status_ != ConnStatus::Disconnected && buffer->readableBytes() > 0)
+        recvMsgCallback_(thisPtr, buffer);
+}
 void TcpConnectionImpl::extendLife()
 {
     if (idleTimeout_ > 0)
@@ -190,11 +290,23 @@ void TcpConnectionImpl::extendLife()
         }
     }
 }
+void TcpConnectionImpl::popWriteBufferFront()
+{
+    auto &node = writeBufferList_.front();
+    if (node->isMemory())
+        BufferNode::recycleMemBufferNode(std::move(node));
+    writeBufferList_.pop_front();
+    if (controlEnd_ > 0 && --controlEnd_ == 0)
+        controlBytesAhead_ = 0;
+    if (controlBehind_ > 0)
+        --controlBehind_;
+}
 void TcpConnectionImpl::writeCallback()
 {
     loop_->assertInLoopThread();
-    if (ioChannelPtr_->isWriting())
+    if (ioChannel_.isWriting())
     {
+        writeBudget_ = notSentLowWaterMark_;
         if (tlsProviderPtr_)
         {
             bool sentAll = tlsProviderPtr_->sendBufferedData();
@@ -203,33 +315,15 @@ void TcpConnectionImpl::writeCallback()
                 return;
             }
         }
-        while (!writeBufferList_.empty())
-        {
-            auto &nodePtr = writeBufferList_.front();
-            if (nodePtr->remainingBytes() == 0)
-            {
-                if (!nodePtr->isAsync() || !nodePtr->available())
-                {
-                    writeBufferList_.pop_front();
-                }
-                else
-                {
-                    ioChannelPtr_->disableWriting();
-                    return;
-                }
-            }
-            else
-            {
-                auto n = sendNodeInLoop(nodePtr);
-                if (nodePtr->remainingBytes() > 0 || n < 0)
-                    return;
-            }
-        }
+        if (!sendWriteBufferInLoop())
+            return;
         assert(writeBufferList_.empty());
+        scheduleWriteComplete();
+        resumeForwardSource();
         if (tlsProviderPtr_ == nullptr ||
             tlsProviderPtr_->getBufferedData().readableBytes() == 0)
         {
-            ioChannelPtr_->disableWriting();
+            ioChannel_.disableWriting();
             if (closeOnEmpty_)
             {
                 shutdown();
@@ -241,6 +335,201 @@ void TcpConnectionImpl::writeCallback()
         LOG_SYSERR << "no writing but write callbcak called";
     }
 }
+bool TcpConnectionImpl::sendWriteBufferInLoop()
+{
+    auto sentBefore = bytesSent_;
+    bool sentAll = drainWriteBufferInLoop();
+    removeQueuedBytes(bytesSent_ - sentBefore);
+    // The low water mark callback may have queued more data.
+    return sentAll && writeBufferList_.empty();
+}
+bool TcpConnectionImpl::drainWriteBufferInLoop()
+{
+    while (!writeBufferList_.empty())
+    {
+#ifndef _WIN32
+        if (writeBufferList_.front()->isMemory() && !encryptsInUserSpace())
+        {
+            // Consecutive memory nodes are flushed with one writev().
+            if (!sendMemNodesInLoop())
+                return false;
+            continue;
+        }
+#endif
+        // Not a reference: callbacks run while sending may queue more nodes
+        // and reallocate the queue.
+        auto nodePtr = writeBufferList_.front();
+        if (remainingBytesOf(nodePtr) == 0)
+        {
+            if (!nodePtr->isAsync() || !nodePtr->available())
+            {
+                nodePtr.reset();
+                popWriteBufferFront();
+            }
+            else
+            {
+                if (ioChannel_.isWriting())
+                    ioChannel_.disableWriting();
+                return false;
+            }
+        }
+        else
+        {
+            auto n = sendNodeInLoop(nodePtr);
+            if (nodePtr->remainingBytes() > 0 || n < 0)
+                return false;
+        }
+    }
+    return true;
+}
+void TcpConnectionImpl::scheduleWriteComplete()
+{
+    if (!writeCompleteCallback_ || writeCompletePending_)
+        return;
+    // Report in the next loop iteration, after the events of the other
+    // channels: a callback sending more data doesn't starve them.
+    writeCompletePending_ = true;
+    loop_->queueInNextIteration(
+        [weakPtr = weak_from_this()]()
+        {
+            auto thisPtr = weakPtr.lock();
+            if (!thisPtr)
+                return;
+            thisPtr->writeCompletePending_ = false;
+            if (thisPtr->status_ == ConnStatus::Disconnected ||
+                !thisPtr->writeBufferList_.empty() ||
+                (thisPtr->tlsProviderPtr_ &&
+                 thisPtr->tlsProviderPtr_->getBufferedData().readableBytes() >
+                     0))
+                return;
+            if (thisPtr->writeCompleteCallback_)
+                thisPtr->writeCompleteCallback_(thisPtr);
+        });
+}
+void TcpConnectionImpl::flushInLoop()
+{
+    loop_->assertInLoopThread();
+    flushPending_ = false;
+    // When writing is enabled, the pending data is sent by writeCallback().
+    if (ioChannel_.isWriting() || writeBufferList_.empty() ||
+        status_ == ConnStatus::Disconnected)
+        return;
+    if (!sendWriteBufferInLoop())
+        return;
+    scheduleWriteComplete();
+    resumeForwardSource();
+    if (closeOnEmpty_)
+    {
+        shutdown();
+    }
+}
+void TcpConnectionImpl::scheduleFlush()
+{
+    if (autoBatch_ && !flushPending_ && !ioChannel_.isWriting())
+    {
+        // Flush once at the end of the current loop iteration.
+        flushPending_ = true;
+        loop_->queueInLoop([thisPtr = shared_from_this()]()
+                           { thisPtr->flushInLoop(); });
+    }
+}
+void TcpConnectionImpl::flush()
+{
+    loop_->runInLoop([thisPtr = shared_from_this()]()
+                     { thisPtr->flushInLoop(); });
+}
+void TcpConnectionImpl::setAutoBatch(bool on)
+{
+    loop_->runInLoop(
+        [thisPtr = shared_from_this(), on]()
+        {
+            thisPtr->autoBatch_ = on;
+            if (!on)
+                thisPtr->flushInLoop();
+        });
+}
+void TcpConnectionImpl::setZeroCopyThreshold(size_t threshold)
+{
+    loop_->runInLoop(
+        [thisPtr = shared_from_this(), threshold]()
+        {
+            if (threshold > 0 && !thisPtr->zeroCopyEnabled_)
+            {
+                if (thisPtr->tlsProviderPtr_)
+                {
+                    LOG_WARN << "MSG_ZEROCOPY is not supported on TLS "
+                                "connections";
+                    return;
+                }
+                if (!thisPtr->socket_.setZeroCopy(true))
+                    return;
+                thisPtr->zeroCopyEnabled_ = true;
+            }
+            thisPtr->zeroCopyThreshold_ = threshold;
+        });
+}
+void TcpConnectionImpl::setAsyncPrefetch(bool on)
+{
+    loop_->runInLoop([thisPtr = shared_from_this(), on]()
+                     { thisPtr->asyncPrefetch_ = on; });
+}
+void TcpConnectionImpl::setFileCacheHints(bool readahead, bool dropBehind)
+{
+    fileCacheHints_ =
+        (readahead ? BufferNode::kFileReadahead : BufferNode::kNoFileHints) |
+        (dropBehind ? BufferNode::kFileDropBehind : BufferNode::kNoFileHints);
+}
+void TcpConnectionImpl::setNotSentLowWaterMark(size_t bytes)
+{
+    loop_->runInLoop(
+        [thisPtr = shared_from_this(), bytes]()
+        {
+            if (!thisPtr->socket_.setNotSentLowWaterMark(bytes))
+                return;
+            thisPtr->notSentLowWaterMark_ = bytes;
+            thisPtr->writeBudget_ = bytes;
+        });
+}
+void TcpConnectionImpl::pauseReading()
+{
+    loop_->runInLoop(
+        [thisPtr = shared_from_this()]()
+        {
+            thisPtr->readingPaused_ = true;
+            thisPtr->updateReading();
+        });
+}
+void TcpConnectionImpl::resumeReading()
+{
+    loop_->runInLoop(
+        [thisPtr = shared_from_this()]()
+        {
+            thisPtr->readingPaused_ = false;
+            thisPtr->updateReading();
+        });
+}
+void TcpConnectionImpl::setReadingPausedByServer(bool paused)
+{
+    loop_->runInLoop(
+        [thisPtr = shared_from_this(), paused]()
+        {
+            thisPtr->readingPausedByServer_ = paused;
+            thisPtr->updateReading();
+        });
+}
+void TcpConnectionImpl::updateReading()
+{
+    if (readingPaused_ || readingPausedByServer_ || readingPausedByForward_)
+    {
+        if (ioChannel_.isReading())
+            ioChannel_.disableReading();
+    }
+    else if (status_ != ConnStatus::Disconnected &&
+             !ioChannel_.isReading())
+    {
+        ioChannel_.enableReading();
+    }
+}
 void TcpConnectionImpl::connectEstablished()
 {
     auto thisPtr = shared_from_this();
@@ -248,8 +537,8 @@ void TcpConnectionImpl::connectEstablished()
                      {
         LOG_TRACE << "connectEstablished";
         assert(thisPtr->status_ == ConnStatus::Connecting);
-        thisPtr->ioChannelPtr_->tie(thisPtr);
-        thisPtr->ioChannelPtr_->enableReading();
+        thisPtr->ioChannel_.tie(thisPtr);
+        thisPtr->ioChannel_.enableReading();
         thisPtr->status_ = ConnStatus::Connected;
 
         if(thisPtr->tlsProviderPtr_)
@@ -259,7 +548,7 @@ void TcpConnectionImpl::connectEstablished()
 }
 void TcpConnectionImpl::handleClose()
 {
-    LOG_TRACE << "connection closed, fd=" << socketPtr_->fd();
+    LOG_TRACE << "connection closed, fd=" << socket_.fd();
     LOG_TRACE << "write buffer size: " << writeBufferList_.size();
     if (!writeBufferList_.empty())
     {
@@ -268,7 +557,7 @@ void TcpConnectionImpl::handleClose()
     }
     loop_->assertInLoopThread();
     status_ = ConnStatus::Disconnected;
-    ioChannelPtr_->disableAll();
+    ioChannel_.disableAll();
     auto guardThis = shared_from_this();
     if (connectionCallback_)
         connectionCallback_(guardThis);
@@ -280,7 +569,9 @@ void TcpConnectionImpl::handleClose()
 }
 void TcpConnectionImpl::handleError()
 {
-    int err = socketPtr_->getSocketError();
+    if (zeroCopyEnabled_)
+        handleZeroCopyCompletions();
+    int err = socket_.getSocketError();
     if (err == 0)
         return;
     if (err == EPIPE ||
@@ -289,18 +580,46 @@ void TcpConnectionImpl::handleError()
 #endif
         err == ECONNRESET)
     {
-        LOG_TRACE << "[" << name_ << "] - SO_ERROR = " << err << " "
+        LOG_TRACE << "[" << name() << "] - SO_ERROR = " << err << " "
                   << strerror(err);
     }
     else
     {
-        LOG_ERROR << "[" << name_ << "] - SO_ERROR = " << err << " "
+        LOG_ERROR << "[" << name() << "] - SO_ERROR = " << err << " "
                   << strerror(err);
     }
 }
 void TcpConnectionImpl::setTcpNoDelay(bool on)
 {
-    socketPtr_->setTcpNoDelay(on);
+    socket_.setTcpNoDelay(on);
+}
+bool TcpConnectionImpl::setBusyPoll(int usec)
+{
+    return socket_.setBusyPoll(usec);
+}
+bool TcpConnectionImpl::setIncomingCpu(int cpu)
+{
+    return socket_.setIncomingCpu(cpu);
+}
+bool TcpConnectionImpl::setRecvBufferSize(int bytes)
+{
+    return socket_.setRecvBufferSize(bytes);
+}
+bool TcpConnectionImpl::setSendBufferSize(int bytes)
+{
+    return socket_.setSendBufferSize(bytes);
+}
+bool TcpConnectionImpl::setQuickAck(bool on)
+{
+    return socket_.setQuickAck(on);
+}
+bool TcpConnectionImpl::setUserTimeout(unsigned int ms)
+{
+    return socket_.setUserTimeout(ms);
+}
+void TcpConnectionImpl::setSocketPolicy(const SocketPolicy &policy)
+{
+    socket_.applyPolicy(policy);
 }
 void TcpConnectionImpl::connectDestroyed()
 {
@@ -308,11 +627,12 @@ void TcpConnectionImpl::connectDestroyed()
     if (status_ == ConnStatus::Connected)
     {
         status_ = ConnStatus::Disconnected;
-        ioChannelPtr_->disableAll();
+        ioChannel_.disableAll();
 
         connectionCallback_(shared_from_this());
     }
-    ioChannelPtr_->remove();
+    ioChannel_.remove();
+    setMemoryUsage(0, 0);
 }
 void TcpConnectionImpl::shutdown()
 {
@@ -332,18 +652,18 @@ void TcpConnectionImpl::shutdown()
                     thisPtr->closeOnEmpty_ = true;
                     return;
                 }
-                thisPtr->tlsProviderPtr_->close();
+                thisPtr->closeTLS();
             }
             if(thisPtr->tlsProviderPtr_ == nullptr &&
             !thisPtr->writeBufferList_.empty())
             {
-                thisPtr->closeOnEmpty_ - true;
+                thisPtr->closeOnEmpty_ = true;
                 return;
             }
             thisPtr->status_ = ConnStatus::Disconnecting;
-            if(!thisPtr->ioChannelPtr_->isWriting())
+            if(!thisPtr->ioChannel_.isWriting())
             {
-                thisPtr->socketPtr_->closeWrite();
+                thisPtr->socket_.closeWrite();
             }
         } });
 }
@@ -360,7 +680,7 @@ void TcpConnectionImpl::forceClose()
             thisPtr->handleClose();
 
             if(thisPtr->tlsProviderPtr_)
-                thisPtr->tlsProviderPtr_->close();
+                thisPtr->closeTLS();
         } });
 }
 #ifndef _WIN32
@@ -376,7 +696,7 @@ void TcpConnectionImpl::sendInLoop(const char *buffer, size_t length)
         return;
     }
     ssize_t sendLen = 0;
-    if (!ioChannelPtr_->isWriting() && writeBufferList_.empty())
+    if (!autoBatch_ && !ioChannel_.isWriting() && writeBufferList_.empty())
     {
         // send directly
         sendLen = writeInLoop(buffer, length);
@@ -389,55 +709,420 @@ void TcpConnectionImpl::sendInLoop(const char *buffer, size_t length)
     }
     if (length > 0 && status_ == ConnStatus::Connected)
     {
-        if (writeBufferList_.empty() || writeBufferList_.back()->isFile() ||
-            writeBufferList_.back()->isStream())
+        appendToWriteBuffer(static_cast<const char *>(buffer) + sendLen,
+                            length);
+    }
+}
+#ifndef _WIN32
+void TcpConnectionImpl::sendInLoop(const ConstBuffer *buffers, size_t count)
+{
+    loop_->assertInLoopThread();
+    if (status_ != ConnStatus::Connected)
+    {
+        LOG_DEBUG << "Connection is not connected,give up sending";
+        return;
+    }
+    size_t index = 0;
+    size_t offset = 0;
+    if (!autoBatch_ && !ioChannel_.isWriting() &&
+        writeBufferList_.empty() && !encryptsInUserSpace())
+    {
+#ifdef IOV_MAX
+        constexpr size_t kMaxIovecs = IOV_MAX;
+#else
+        constexpr size_t kMaxIovecs = 1024;
+#endif
+        struct iovec vecs[kMaxIovecs];
+        while (index < count)
         {
-            writeBufferList_.push_back(BufferNode::newMemBufferNode());
+            size_t n = 0;
+            size_t total = 0;
+            for (size_t i = index; i < count && n < kMaxIovecs; ++i)
+            {
+                if (buffers[i].length == 0)
+                    continue;
+                vecs[n].iov_base = const_cast<void *>(buffers[i].data);
+                vecs[n].iov_len = buffers[i].length;
+                total += buffers[i].length;
+                ++n;
+            }
+            if (n == 0)
+                return;
+            auto sendLen = writevRaw(vecs, static_cast<int>(n));
+            if (sendLen < 0)
+            {
+                LOG_TRACE << "write error";
+                return;
+            }
+            // skip the buffers which have been sent
+            auto sent = static_cast<size_t>(sendLen);
+            while (index < count && sent >= buffers[index].length)
+            {
+                sent -= buffers[index].length;
+                ++index;
+            }
+            offset = sent;
+            if (static_cast<size_t>(sendLen) < total)
+                break;
         }
-        writeBufferList_.back()->append(static_cast<const char *>(buffer) +
-                                            sendLen,
-                                        length);
-        if (highWaterMarkCallback_ &&
-            writeBufferList_.back()->remainingBytes() >
-                static_cast<long long>(highWaterMarkLen_))
+    }
+    // Once data has to be queued, the rest of the call is queued in one node
+    // so that no control message is queued between two of its buffers.
+    for (; index < count && status_ == ConnStatus::Connected; ++index)
+    {
+        if (ioChannel_.isWriting() || !writeBufferList_.empty())
         {
-            highWaterMarkCallback_(shared_from_this(),
-                                   writeBufferList_.back()->remainingBytes());
+            appendToWriteBuffer(buffers + index, count - index, offset);
+            break;
         }
-        if (highWaterMarkCallback_ && tlsProviderPtr_ &&
-            tlsProviderPtr_->getBufferedData().readableBytes() >
-                highWaterMarkLen_)
+        if (buffers[index].length > offset)
+            sendInLoop(static_cast<const char *>(buffers[index].data) + offset,
+                       buffers[index].length - offset);
+        offset = 0;
+    }
+}
+#endif
+void TcpConnectionImpl::sendInLoop(std::string &&msg)
+{
+    if (zeroCopyEligible(msg.length()))
+    {
+        auto msgPtr = std::make_shared<std::string>(std::move(msg));
+        auto data = msgPtr->data();
+        auto length = msgPtr->length();
+        sendZeroCopyInLoop(std::move(msgPtr), data, length);
+        return;
+    }
+    sendInLoop(msg.data(), msg.length());
+}
+void TcpConnectionImpl::sendInLoop(MsgBuffer &&buffer)
+{
+    if (zeroCopyEligible(buffer.readableBytes()))
+    {
+        auto bufferPtr = std::make_shared<MsgBuffer>(std::move(buffer));
+        auto data = bufferPtr->peek();
+        auto length = bufferPtr->readableBytes();
+        sendZeroCopyInLoop(std::move(bufferPtr), data, length);
+        return;
+    }
+    sendInLoop(buffer.peek(), buffer.readableBytes());
+}
+void TcpConnectionImpl::sendInLoop(const std::shared_ptr<std::string> &msgPtr)
+{
+    if (zeroCopyEligible(msgPtr->length()))
+    {
+        sendZeroCopyInLoop(msgPtr, msgPtr->data(), msgPtr->length());
+        return;
+    }
+    sendInLoop(msgPtr->data(), msgPtr->length());
+}
+void TcpConnectionImpl::sendInLoop(const std::shared_ptr<MsgBuffer> &msgPtr)
+{
+    if (zeroCopyEligible(msgPtr->readableBytes()))
+    {
+        sendZeroCopyInLoop(msgPtr, msgPtr->peek(), msgPtr->readableBytes());
+        return;
+    }
+    sendInLoop(msgPtr->peek(), msgPtr->readableBytes());
+}
+void TcpConnectionImpl::sendZeroCopyInLoop(std::shared_ptr<void> &&owner,
+                                           const char *data,
+                                           size_t length)
+{
+    loop_->assertInLoopThread();
+    if (status_ != ConnStatus::Connected)
+    {
+        LOG_DEBUG << "Connection is not connected,give up sending";
+        return;
+    }
+    sendOrQueueNodeInLoop(
+        BufferNode::newZeroCopyBufferNode(std::move(owner), data, length));
+}
+void TcpConnectionImpl::addQueuedBytes(long long n)
+{
+    if (n <= 0)
+        return;
+    bytesQueued_ += static_cast<size_t>(n);
+    if (lowWaterMarkCallback_ && bytesQueued_ > lowWaterMarkLen_)
+        lowWaterMarkArmed_ = true;
+    updateMemoryUsage();
+    if (highWaterMarkCallback_ && bytesQueued_ > highWaterMarkLen_)
+        highWaterMarkCallback_(shared_from_this(), bytesQueued_);
+}
+void TcpConnectionImpl::updateMemoryUsage()
+{
+    // Files, pipes and streams only hold a descriptor or a chunk.
+    auto sendUsage = bytesQueued_ - std::min(queuedFdBytes_, bytesQueued_);
+    auto usage = readBuffer_.readableBytes();
+    if (tlsProviderPtr_)
+    {
+        usage += tlsProviderPtr_->getRecvBuffer().readableBytes();
+        sendUsage += tlsProviderPtr_->getBufferedData().readableBytes();
+    }
+    setMemoryUsage(usage + sendUsage, sendUsage);
+}
+void TcpConnectionImpl::setMemoryUsage(size_t usage, size_t sendUsage)
+{
+    sendMemoryUsage_ = sendUsage;
+    auto old = memoryUsage_.exchange(usage);
+    if (old == usage)
+        return;
+    // Unsigned arithmetic, a decrease wraps around as expected.
+    if (loopMemoryCounter_)
+        *loopMemoryCounter_ += usage - old;
+    if (serverMemoryCounter_)
+        *serverMemoryCounter_ += usage - old;
+}
+void TcpConnectionImpl::removeQueuedBytes(size_t n)
+{
+    // Reset when drained, the estimates of streams are not exact.
+    if (writeBufferList_.empty() || n >= bytesQueued_)
+    {
+        bytesQueued_ = 0;
+        queuedFdBytes_ = 0;
+    }
+    else
+    {
+        bytesQueued_ -= n;
+    }
+    updateMemoryUsage();
+    if (lowWaterMarkArmed_ && bytesQueued_ <= lowWaterMarkLen_)
+    {
+        lowWaterMarkArmed_ = false;
+        if (lowWaterMarkCallback_)
+            lowWaterMarkCallback_(shared_from_this(), bytesQueued_);
+    }
+}
+void TcpConnectionImpl::sendOrQueueNodeInLoop(BufferNodePtr &&node)
+{
+    if (!autoBatch_ && !ioChannel_.isWriting() && writeBufferList_.empty())
+    {
+        auto n = sendNodeInLoop(node);
+        // An async node without data yet is kept until it is finished.
+        if (n < 0 || (node->remainingBytes() == 0 &&
+                      !(node->isAsync() && node->available())))
+            return;
+    }
+    auto length = node->remainingBytes();
+    if (length > 0 && !holdsDataInMemory(*node))
+        queuedFdBytes_ += static_cast<size_t>(length);
+    writeBufferList_.push_back(std::move(node));
+    scheduleFlush();
+    addQueuedBytes(length);
+}
+void TcpConnectionImpl::removeQueuedFdBytes(ssize_t n)
+{
+    if (n <= 0)
+        return;
+    // Also called for nodes sent before being queued.
+    queuedFdBytes_ -= std::min(static_cast<size_t>(n), queuedFdBytes_);
+}
+void TcpConnectionImpl::handleZeroCopyCompletions()
+{
+#ifdef __linux__
+    char control[128];
+    while (true)
+    {
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if (::recvmsg(socket_.fd(), &msg, MSG_ERRQUEUE) < 0)
+            break;
+        for (auto cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr;
+             cmsg = CMSG_NXTHDR(&msg, cmsg))
         {
-            highWaterMarkCallback_(
-                shared_from_this(),
-                tlsProviderPtr_->getBufferedData().readableBytes());
+            if (!((cmsg->cmsg_level == SOL_IP &&
+                   cmsg->cmsg_type == IP_RECVERR) ||
+                  (cmsg->cmsg_level == SOL_IPV6 &&
+                   cmsg->cmsg_type == IPV6_RECVERR)))
+                continue;
+            auto serr =
+                reinterpret_cast<struct sock_extended_err *>(CMSG_DATA(cmsg));
+            if (serr->ee_errno != 0 ||
+                serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+                continue;
+            if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+            {
+                LOG_TRACE << "[" << name()
+                          << "] - MSG_ZEROCOPY fell back to copying";
+            }
+            // Notifications of a TCP socket arrive in order, so every node
+            // whose last send is not after the end of the range is released.
+            uint32_t hi = serr->ee_data;
+            if (static_cast<int32_t>(hi + 1 - zeroCopyAcked_) > 0)
+                zeroCopyAcked_ = hi + 1;
+            while (!zeroCopyPending_.empty() &&
+                   static_cast<int32_t>(zeroCopyPending_.front().first - hi) <=
+                       0)
+            {
+                zeroCopyPending_.pop_front();
+            }
         }
     }
+#endif
+}
+void TcpConnectionImpl::appendToWriteBuffer(const char *data, size_t length)
+{
+    ConstBuffer buffer{data, length};
+    appendToWriteBuffer(&buffer, 1, 0);
+}
+void TcpConnectionImpl::appendToWriteBuffer(const ConstBuffer *buffers,
+                                            size_t count,
+                                            size_t offset)
+{
+    size_t length = 0;
+    for (size_t i = 0; i < count; ++i)
+        length += buffers[i].length;
+    if (length <= offset)
+        return;
+    length -= offset;
+    // Small sends are merged into nodes of up to about 16KB: the nodes stay
+    // small enough to be pooled and control messages don't wait long for
+    // the node being sent, writev() still sends many of them at once. The
+    // nodes of control messages are not merged into, later control messages
+    // are appended to them.
+    constexpr size_t kMaxMergedBytes = 16 * 1024;
+    if (writeBufferList_.size() <= controlEnd_ ||
+        !writeBufferList_.back()->isMemory() ||
+        static_cast<size_t>(remainingBytesOf(writeBufferList_.back())) >=
+            kMaxMergedBytes)
+    {
+        writeBufferList_.push_back(BufferNode::newMemBufferNode());
+    }
+    // All the buffers go to the same node, a control message is never
+    // queued between them.
+    auto &node = writeBufferList_.back();
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (buffers[i].length > offset)
+            node->append(static_cast<const char *>(buffers[i].data) + offset,
+                         buffers[i].length - offset);
+        offset = 0;
+    }
+    scheduleFlush();
+    addQueuedBytes(static_cast<long long>(length));
+    if (highWaterMarkCallback_ && tlsProviderPtr_ &&
+        tlsProviderPtr_->getBufferedData().readableBytes() >
+            highWaterMarkLen_)
+    {
+        highWaterMarkCallback_(
+            shared_from_this(),
+            tlsProviderPtr_->getBufferedData().readableBytes());
+    }
+}
+void TcpConnectionImpl::sendControlInLoop(const char *data, size_t length)
+{
+    loop_->assertInLoopThread();
+    if (status_ != ConnStatus::Connected)
+    {
+        LOG_DEBUG << "Connection is not connected,give up sending";
+        return;
+    }
+    // Bounds the control bytes sent before the other data makes progress.
+    constexpr size_t kMaxControlBytesAhead = 64 * 1024;
+    if (writeBufferList_.empty() || controlBehind_ > 0 ||
+        controlBytesAhead_ + length > kMaxControlBytesAhead)
+    {
+        sendInLoop(data, length);
+        if (!writeBufferList_.empty())
+            controlBehind_ = writeBufferList_.size() - 1;
+        return;
+    }
+    if (controlEnd_ > 0 && writeBufferList_[controlEnd_ - 1]->isMemory())
+    {
+        writeBufferList_[controlEnd_ - 1]->append(data, length);
+    }
+    else
+    {
+        // The front node may be partly sent, unless it's an async stream
+        // waiting for data.
+        auto &front = writeBufferList_.front();
+        size_t index = controlEnd_;
+        if (index == 0 && !(front->isAsync() && front->remainingBytes() == 0))
+            index = 1;
+        auto node = BufferNode::newMemBufferNode();
+        node->append(data, length);
+        writeBufferList_.insert(index, std::move(node));
+        controlEnd_ = index + 1;
+    }
+    controlBytesAhead_ += length;
+    addQueuedBytes(static_cast<long long>(length));
+    // Writing is disabled while an async stream waits for data.
+    if (autoBatch_)
+        scheduleFlush();
+    else if (!ioChannel_.isWriting())
+        ioChannel_.enableWriting();
+}
+void TcpConnectionImpl::sendControl(const char *msg, size_t len)
+{
+    if (loop_->isInLoopThread())
+    {
+        sendControlInLoop(msg, len);
+    }
+    else
+    {
+        auto buffer = std::make_shared<std::string>(msg, len);
+        loop_->queueInLoop(
+            [thisPtr = shared_from_this(), buffer = std::move(buffer)]()
+            {
+                thisPtr->sendControlInLoop(buffer->data(), buffer->length());
+            });
+    }
 }
 // The order of data sending should be same as the order of calls of send()
 void TcpConnectionImpl::send(const std::shared_ptr<std::string> &msgPtr)
 {
     if (loop_->isInLoopThread())
     {
-        sendInLoop(msgPtr->data(), msgPtr->length());
+        sendInLoop(msgPtr);
+    }
+    else
+    {
+        loop_->queueInLoop([thisPtr = shared_from_this(), msgPtr]()
+                           { thisPtr->sendInLoop(msgPtr); });
+    }
+}
+// The order of data sending should be same as the order of calls of send()
+void TcpConnectionImpl::send(const std::shared_ptr<MsgBuffer> &msgPtr)
+{
+    if (loop_->isInLoopThread())
+    {
+        sendInLoop(msgPtr);
     }
     else
     {
         loop_->queueInLoop([thisPtr = shared_from_this(), msgPtr]()
-                           { thisPtr->sendInLoop(msgPtr->data(), msgPtr->length()); });
+                           { thisPtr->sendInLoop(msgPtr); });
     }
 }
-// The order of data sending should be same as the order of calls of send()
-void TcpConnectionImpl::send(const std::shared_ptr<MsgBuffer> &msgPtr)
+
+void TcpConnectionImpl::send(const ConstBuffer *buffers, size_t count)
 {
     if (loop_->isInLoopThread())
     {
-        sendInLoop(msgPtr->peek(), msgPtr->readableBytes());
+#ifndef _WIN32
+        sendInLoop(buffers, count);
+#else
+        for (size_t i = 0; i < count; ++i)
+            sendInLoop(static_cast<const char *>(buffers[i].data),
+                       buffers[i].length);
+#endif
     }
     else
     {
-        loop_->queueInLoop([thisPtr = shared_from_this(), msgPtr]()
-                           { thisPtr->sendInLoop(msgPtr->peek(), msgPtr->readableBytes()); });
+        size_t total = 0;
+        for (size_t i = 0; i < count; ++i)
+            total += buffers[i].length;
+        auto buffer = std::make_shared<std::string>();
+        buffer->reserve(total);
+        for (size_t i = 0; i < count; ++i)
+            buffer->append(static_cast<const char *>(buffers[i].data),
+                           buffers[i].length);
+        loop_->queueInLoop(
+            [thisPtr = shared_from_this(), buffer = std::move(buffer)]()
+            {
+                thisPtr->sendInLoop(buffer->data(), buffer->length());
+            });
     }
 }
 
@@ -495,14 +1180,14 @@ void TcpConnectionImpl::send(std::string &&msg)
 {
     if (loop_->isInLoopThread())
     {
-        sendInLoop(msg.data(), msg.length());
+        sendInLoop(std::move(msg));
     }
     else
     {
         loop_->queueInLoop(
-            [thisPtr = shared_from_this(), msg = std::move(msg)]()
+            [thisPtr = shared_from_this(), msg = std::move(msg)]() mutable
             {
-                thisPtr->sendInLoop(msg.data(), msg.length());
+                thisPtr->sendInLoop(std::move(msg));
             });
     }
 }
@@ -524,14 +1209,14 @@ void TcpConnectionImpl::send(MsgBuffer &&buffer)
 {
     if (loop_->isInLoopThread())
     {
-        sendInLoop(buffer.peek(), buffer.readableBytes());
+        sendInLoop(std::move(buffer));
     }
     else
     {
         loop_->queueInLoop(
-            [thisPtr = shared_from_this(), buffer = std::move(buffer)]()
+            [thisPtr = shared_from_this(), buffer = std::move(buffer)]() mutable
             {
-                thisPtr->sendInLoop(buffer.peek(), buffer.readableBytes());
+                thisPtr->sendInLoop(std::move(buffer));
             });
     }
 }
@@ -543,7 +1228,10 @@ void TcpConnectionImpl::sendFile(const char *fileName,
     assert(fileName);
 #ifdef _WIN32
 #else
-    auto fileNode = BufferNode::newFileBufferNode(fileName, offset, length);
+    auto fileNode = BufferNode::newFileBufferNode(fileName,
+                                                  offset,
+                                                  length,
+                                                  fileCacheHints_);
     if (!fileNode->available())
     {
         LOG_SYSERR << fileName << " open error";
@@ -570,66 +1258,179 @@ void TcpConnectionImpl::sendFile(BufferNodePtr &&fileNode)
     assert(fileNode->isFile() && fileNode->remainingBytes() > 0);
     if (loop_->isInLoopThread())
     {
-        if (writeBufferList_.empty())
+        sendFileOrStreamInLoop(std::move(fileNode));
+    }
+    else
+    {
+        loop_->queueInLoop(
+            [thisPtr = shared_from_this(), node = std::move(fileNode)]() mutable
+            { thisPtr->sendFileOrStreamInLoop(std::move(node)); });
+    }
+}
+
+void TcpConnectionImpl::sendFileOrStreamInLoop(BufferNodePtr &&node)
+{
+    loop_->assertInLoopThread();
+    // Files sent with sendfile() are read by the kernel.
+    if (asyncPrefetch_ && (node->isStream() || encryptsInUserSpace()))
+    {
+        std::weak_ptr<TcpConnectionImpl> weakPtr = shared_from_this();
+        node = BufferNode::newPrefetchBufferNode(
+            std::move(node),
+            [weakPtr, loop = loop_]()
+            {
+                loop->queueInLoop(
+                    [weakPtr]()
+                    {
+                        auto thisPtr = weakPtr.lock();
+                        if (thisPtr)
+                            thisPtr->resumeWritingInLoop();
+                    });
+            });
+    }
+    sendOrQueueNodeInLoop(std::move(node));
+}
+
+void TcpConnectionImpl::resumeWritingInLoop()
+{
+    // A node that was waiting for data may have some now.
+    if (status_ != ConnStatus::Disconnected && !writeBufferList_.empty() &&
+        !ioChannel_.isWriting())
+        ioChannel_.enableWriting();
+}
+
+void TcpConnectionImpl::sendFromFd(int fd, size_t length)
+{
+#ifdef __linux__
+    auto node = BufferNode::newPipeBufferNode(fd, length);
+    if (loop_->isInLoopThread())
+    {
+        if (status_ == ConnStatus::Connected)
+            sendOrQueueNodeInLoop(std::move(node));
+    }
+    else
+    {
+        loop_->queueInLoop(
+            [thisPtr = shared_from_this(), node = std::move(node)]() mutable
+            {
+                if (thisPtr->status_ == ConnStatus::Connected)
+                    thisPtr->sendOrQueueNodeInLoop(std::move(node));
+            });
+    }
+#else
+    (void)fd;
+    (void)length;
+    LOG_ERROR << "sendFromFd() is only supported on Linux";
+#endif
+}
+
+void TcpConnectionImpl::forwardTo(const TcpConnectionPtr &target)
+{
+#ifdef __linux__
+    auto targetImpl = std::dynamic_pointer_cast<TcpConnectionImpl>(target);
+    if (!targetImpl || target->getLoop() != loop_)
+    {
+        LOG_ERROR << "Data can only be forwarded to a connection in the same "
+                     "event loop";
+        return;
+    }
+    loop_->runInLoop(
+        [thisPtr = shared_from_this(), targetImpl = std::move(targetImpl)]()
         {
-            auto n = sendNodeInLoop(fileNode);
-            if (fileNode->remainingBytes() > 0 && n >= 0)
-                writeBufferList_.push_back(std::move(fileNode));
-            return;
-        }
-        else
+            if (thisPtr->tlsProviderPtr_ || targetImpl->tlsProviderPtr_)
+            {
+                LOG_ERROR << "Data can't be forwarded on TLS connections";
+                return;
+            }
+            thisPtr->forwardTarget_ = targetImpl;
+            // Forward the data already received.
+            if (thisPtr->readBuffer_.readableBytes() > 0)
+            {
+                targetImpl->sendInLoop(thisPtr->readBuffer_.peek(),
+                                       thisPtr->readBuffer_.readableBytes());
+                thisPtr->readBuffer_.retrieveAll();
+            }
+        });
+#else
+    (void)target;
+    LOG_ERROR << "forwardTo() is only supported on Linux";
+#endif
+}
+
+void TcpConnectionImpl::forwardInLoop()
+{
+#ifdef __linux__
+    auto target = forwardTarget_.lock();
+    if (!target || target->status_ != ConnStatus::Connected)
+    {
+        LOG_TRACE << "[" << name() << "] - forwarding target is closed";
+        forwardTarget_.reset();
+        forceClose();
+        return;
+    }
+    int available = 0;
+    if (::ioctl(socket_.fd(), FIONREAD, &available) < 0 || available <= 0)
+    {
+        // Readable without data: the peer closed the connection or an error
+        // occurred.
+        char c;
+        auto n = ::recv(socket_.fd(), &c, 1, MSG_PEEK);
+        if (n == 0 || (n < 0 && !isEAGAIN()))
         {
-            writeBufferList_.push_back(std::move(fileNode));
+            target->shutdown();
+            handleClose();
         }
+        return;
     }
-    else
+    auto node = BufferNode::newPipeBufferNode(socket_.fd(),
+                                              static_cast<size_t>(available),
+                                              true);
+    auto n = node->remainingBytes();
+    if (n == 0)
+        return;
+    bytesReceived_ += n;
+    extendLife();
+    target->sendOrQueueNodeInLoop(std::move(node));
+    if (!target->writeBufferList_.empty())
     {
-        loop_->queueInLoop([thisPtr = shared_from_this(),
-                            node = std::move(fileNode)]() mutable
-                           {
-                               if (thisPtr->writeBufferList_.empty())
-                               {
-                                   auto n = thisPtr->sendNodeInLoop(node);
-                                   if (node->remainingBytes() > 0 && n >= 0)
-                                       thisPtr->writeBufferList_.push_back(std::move(node));
-                               }
-                               else
-                               {
-                                   thisPtr->writeBufferList_.push_back(std::move(node));
-                               } });
+        // The target can't keep up, stop reading until it is drained.
+        readingPausedByForward_ = true;
+        updateReading();
+        target->forwardSource_ = shared_from_this();
     }
+#endif
+}
+
+void TcpConnectionImpl::resumeForwardSource()
+{
+    auto source = forwardSource_.lock();
+    if (!source)
+        return;
+    forwardSource_.reset();
+    source->readingPausedByForward_ = false;
+    if (source->status_ == ConnStatus::Connected)
+        source->updateReading();
 }
 
 void TcpConnectionImpl::sendStream(
-    std::function<std::size_t(char *, std::size_t)> callback)
+    std::function<std::size_t(char *, std::size_t)> callback,
+    size_t chunkSize,
+    long long length)
 {
-    auto node = BufferNode::newStreamBufferNode(std::move(callback));
+    auto node = BufferNode::newStreamBufferNode(std::move(callback),
+                                                chunkSize,
+                                                length);
     if (loop_->isInLoopThread())
     {
-        if (writeBufferList_.empty())
-        {
-            auto n = sendNodeInLoop(node);
-            if (node->remainingBytes() > 0 && n >= 0)
-                writeBufferList_.push_back(std::move(node));
-            return;
-        }
+        sendFileOrStreamInLoop(std::move(node));
     }
     else
     {
         loop_->queueInLoop(
             [thisPtr = shared_from_this(), node = std::move(node)]() mutable
             {
-                LOG_TRACE << "Push send stream to list";
-                if (thisPtr->writeBufferList_.empty())
-                {
-                    auto n = thisPtr->sendNodeInLoop(node);
-                    if (node->remainingBytes() > 0 && n >= 0)
-                        thisPtr->writeBufferList_.push_back(std::move(node));
-                }
-                else
-                {
-                    thisPtr->writeBufferList_.push_back(std::move(node));
-                }
+                LOG_TRACE_HOT << "Push send stream to list";
+                thisPtr->sendFileOrStreamInLoop(std::move(node));
             });
     }
 }
@@ -638,41 +1439,121 @@ ssize_t TcpConnectionImpl::sendNodeInLoop(const BufferNodePtr &nodePtr)
 {
     loop_->assertInLoopThread();
 #ifdef __linux__
-    if (nodePtr->isFile() && !tlsProviderPtr_)
+    if (nodePtr->isFile() && !encryptsInUserSpace())
     {
         static const long long kMaxSendBytes = 0x7ffff000;
-        LOG_TRACE << "send file in loop using linux kernal sendFile()";
+        LOG_TRACE_HOT << "send file in loop using linux kernal sendFile()";
         auto toSend = nodePtr->remainingBytes();
         if (toSend <= 0)
         {
             LOG_ERROR << "0 or negative bytes to send";
             return -1;
         }
-        auto bytesSent =
-            sendfile(socketPtr_->fd(),
-                     nodePtr->getFd(),
-                     nullptr,
-                     static_cast<size_t>(
-                         toSend < kMaxSendBytes ? toSend : kMaxSendBytes));
+        // The file descriptor may be shared, don't use its file position.
+        off_t offset = static_cast<off_t>(nodePtr->fileOffset());
+        auto count = writableLength(static_cast<size_t>(
+            toSend < kMaxSendBytes ? toSend : kMaxSendBytes));
+        ssize_t bytesSent = 0;
+        if (count > 0)
+            bytesSent =
+                sendfile(socket_.fd(), nodePtr->getFd(), &offset, count);
         if (bytesSent > 0)
         {
             nodePtr->retrieve(bytesSent);
             bytesSent_ += bytesSent;
+            removeQueuedFdBytes(bytesSent);
+            consumeWriteBudget(bytesSent);
+            scheduleWriteComplete();
         }
-        else if (!isEAGAIN())
+        else if (count > 0 && !isEAGAIN())
             return -1;
         extendLife();
         if (bytesSent < toSend)
         {
-            LOG_TRACE << "bytesSent = " << bytesSent << " toSend = " << toSend;
-            if (!ioChannelPtr_->isWriting())
-                ioChannelPtr_->enableWriting();
+            LOG_TRACE_HOT << "bytesSent = " << bytesSent << " toSend = " << toSend;
+            if (!ioChannel_.isWriting())
+                ioChannel_.enableWriting();
         }
         return bytesSent;
     }
 #endif
 
-    LOG_TRACE << "send node in loop";
+#ifdef __linux__
+    if (nodePtr->isZeroCopy() && !tlsProviderPtr_)
+    {
+        const char *data;
+        size_t len;
+        ssize_t hasSent = 0;
+        while (nodePtr->remainingBytes() > 0)
+        {
+            nodePtr->getData(data, len);
+            len = writableLength(len);
+            if (len == 0)
+            {
+                if (!ioChannel_.isWriting())
+                    ioChannel_.enableWriting();
+                break;
+            }
+            auto nWritten = ::send(socket_.fd(), data, len, MSG_ZEROCOPY);
+            if (nWritten < 0 && errno == ENOBUFS)
+            {
+                // The pinned memory limit is reached, copy this part.
+                nWritten = writeRaw(data, len);
+            }
+            else if (nWritten >= 0)
+            {
+                ++zeroCopySeq_;
+                bytesSent_ += nWritten;
+                consumeWriteBudget(nWritten);
+                scheduleWriteComplete();
+                extendLife();
+            }
+            if (nWritten < 0)
+            {
+                if (!isEAGAIN())
+                {
+                    LOG_TRACE << "error(" << errno
+                              << ") on send zero copy node in loop";
+                    return -1;
+                }
+                nWritten = 0;
+            }
+            hasSent += nWritten;
+            nodePtr->retrieve(nWritten);
+            if (static_cast<size_t>(nWritten) < len)
+            {
+                if (!ioChannel_.isWriting())
+                    ioChannel_.enableWriting();
+                break;
+            }
+        }
+        // Keep the node until the kernel has released its memory.
+        if (nodePtr->remainingBytes() == 0 && zeroCopySeq_ != zeroCopyAcked_)
+            zeroCopyPending_.emplace_back(zeroCopySeq_ - 1, nodePtr);
+        return hasSent;
+    }
+#endif
+
+#ifdef __linux__
+    if (nodePtr->isPipe() && !encryptsInUserSpace())
+    {
+        auto n = nodePtr->spliceTo(socket_.fd());
+        if (n > 0)
+        {
+            bytesSent_ += n;
+            removeQueuedFdBytes(n);
+            scheduleWriteComplete();
+        }
+        else if (n < 0 && !isEAGAIN())
+            return -1;
+        extendLife();
+        if (nodePtr->remainingBytes() > 0 && !ioChannel_.isWriting())
+            ioChannel_.enableWriting();
+        return n < 0 ? 0 : n;
+    }
+#endif
+
+    LOG_TRACE_HOT << "send node in loop";
     const char *data;
     size_t len;
     ssize_t hasSent = 0;
@@ -701,6 +1582,8 @@ ssize_t TcpConnectionImpl::sendNodeInLoop(const BufferNodePtr &nodePtr)
             return -1;
         }
     }
+    if (!holdsDataInMemory(*nodePtr))
+        removeQueuedFdBytes(hasSent);
     return hasSent;
 }
 
@@ -710,14 +1593,21 @@ ssize_t TcpConnectionImpl::writeRaw(const void *buffer, size_t length)
 ssize_t TcpConnectionImpl::writeRaw(const char *buffer, size_t length)
 #endif
 {
+    auto allowed = writableLength(length);
+    int nWritten = 0;
 #ifndef _WIN32
-    int nWritten = write(socketPtr_->fd(), buffer, length);
+    if (allowed > 0)
+        nWritten = write(socket_.fd(), buffer, allowed);
 #else
 
 #endif
     if (nWritten > 0)
+    {
         bytesSent_ += nWritten;
-    else if (!isEAGAIN)
+        consumeWriteBudget(nWritten);
+        scheduleWriteComplete();
+    }
+    else if (allowed > 0 && !isEAGAIN())
         return nWritten;
     if (nWritten < 0)
     {
@@ -725,21 +1615,128 @@ ssize_t TcpConnectionImpl::writeRaw(const char *buffer, size_t length)
     }
     if (nWritten < static_cast<int>(length))
     {
-        LOG_TRACE << "nWritten = " << nWritten << " length = " << length;
-        if (!ioChannelPtr_->isWriting())
-            ioChannelPtr_->enableReading();
+        LOG_TRACE_HOT << "nWritten = " << nWritten << " length = " << length;
+        if (!ioChannel_.isWriting())
+            ioChannel_.enableWriting();
     }
     extendLife();
     return nWritten;
 }
 
+#ifndef _WIN32
+ssize_t TcpConnectionImpl::writevRaw(const struct iovec *vecs, int count)
+{
+    size_t length = 0;
+    for (int i = 0; i < count; ++i)
+        length += vecs[i].iov_len;
+    ssize_t nWritten = 0;
+    if (count > 0)
+        nWritten = ::writev(socket_.fd(), vecs, count);
+    if (nWritten > 0)
+    {
+        bytesSent_ += nWritten;
+        consumeWriteBudget(nWritten);
+        scheduleWriteComplete();
+    }
+    else if (count > 0 && !isEAGAIN())
+        return nWritten;
+    if (nWritten < 0)
+    {
+        nWritten = 0;
+    }
+    if (static_cast<size_t>(nWritten) < length)
+    {
+        LOG_TRACE_HOT << "nWritten = " << nWritten << " length = " << length;
+        if (!ioChannel_.isWriting())
+            ioChannel_.enableWriting();
+    }
+    extendLife();
+    return nWritten;
+}
+
+bool TcpConnectionImpl::sendMemNodesInLoop()
+{
+    loop_->assertInLoopThread();
+#ifdef IOV_MAX
+    constexpr size_t kMaxIovecs = IOV_MAX;
+#else
+    constexpr size_t kMaxIovecs = 1024;
+#endif
+    struct iovec vecs[kMaxIovecs];
+    size_t n = 0;
+    size_t total = 0;
+    // Less than the queued bytes when the write budget is exhausted.
+    auto limit = writableLength(SIZE_MAX);
+    bool limited = false;
+    // The kind is checked, call the node's methods without virtual dispatch.
+    for (size_t i = 0; i < writeBufferList_.size() && n < kMaxIovecs; ++i)
+    {
+        if (!writeBufferList_[i]->isMemory())
+            break;
+        auto node = static_cast<MemBufferNode *>(writeBufferList_[i].get());
+        if (node->remainingBytes() == 0)
+            continue;
+        if (total == limit)
+        {
+            limited = true;
+            break;
+        }
+        const char *data;
+        size_t len;
+        node->getData(data, len);
+        if (len > limit - total)
+        {
+            len = limit - total;
+            limited = true;
+        }
+        vecs[n].iov_base = const_cast<char *>(data);
+        vecs[n].iov_len = len;
+        total += len;
+        ++n;
+        if (limited)
+            break;
+    }
+    if (limited && !ioChannel_.isWriting())
+        ioChannel_.enableWriting();
+    ssize_t nWritten = 0;
+    if (n > 0)
+    {
+        LOG_TRACE_HOT << "send " << n << " memory nodes in loop";
+        nWritten = writevRaw(vecs, static_cast<int>(n));
+        if (nWritten < 0)
+        {
+            LOG_TRACE << "error(" << errno << ") on send memory nodes in loop";
+            return false;
+        }
+    }
+    // Retrieve the sent bytes from the nodes and drop the drained ones.
+    auto sent = static_cast<size_t>(nWritten);
+    while (!writeBufferList_.empty())
+    {
+        if (!writeBufferList_.front()->isMemory())
+            break;
+        auto node = static_cast<MemBufferNode *>(writeBufferList_.front().get());
+        auto remaining = static_cast<size_t>(node->remainingBytes());
+        if (remaining > sent)
+        {
+            node->retrieve(sent);
+            break;
+        }
+        node->retrieve(remaining);
+        sent -= remaining;
+        popWriteBufferFront();
+    }
+    return !limited && static_cast<size_t>(nWritten) == total;
+}
+#endif
+
 #ifndef _WIN32
 ssize_t TcpConnectionImpl::writeInLoop(const void *buffer, size_t length)
 #else
 ssize_t TcpConnectionImpl::writeInLoop(const char *buffer, size_t length)
 #endif
 {
-    if (tlsProviderPtr_)
+    if (encryptsInUserSpace())
         return tlsProviderPtr_->sendData((const char *)buffer, length);
     else
         return writeRaw(buffer, length);
@@ -796,6 +1793,12 @@ void TcpConnectionImpl::onSslError(TcpConnection *self, SSLError err)
 void TcpConnectionImpl::onHandshakeFinished(TcpConnection *self)
 {
     auto connPtr = ((TcpConnectionImpl *)self)->shared_from_this();
+#ifdef __linux__
+    // The provider may still be processing the received data, switch to
+    // kernel TLS once it returns.
+    connPtr->loop_->queueInLoop([connPtr]()
+                                { connPtr->enableKernelTLSInLoop(); });
+#endif
     if (connPtr->upgradeCallback_)
     {
         connPtr->upgradeCallback_(connPtr);
@@ -804,11 +1807,127 @@ void TcpConnectionImpl::onHandshakeFinished(TcpConnection *self)
     else if (self->connectionCallback_)
         self->connectionCallback_(connPtr);
 }
+void TcpConnectionImpl::enableKernelTLSInLoop()
+{
+#ifdef __linux__
+    loop_->assertInLoopThread();
+    if (!tlsProviderPtr_ || kernelTLSTx_ || status_ != ConnStatus::Connected)
+        return;
+    // The provider stops handling the directions it exports, so only the
+    // ones the kernel can take over now are requested.
+    // Encrypted data still buffered in user space must reach the socket
+    // before the kernel starts writing records.
+    bool canTx = tlsProviderPtr_->getBufferedData().readableBytes() == 0;
+    // Received records that are not processed yet can't be handed over.
+    bool canRx = readBuffer_.readableBytes() == 0;
+    // Don't attach the "tls" ULP to the socket (which may load the kernel
+    // module) unless the provider is able to hand its keys over.
+    if ((!canTx && !canRx) || !tlsProviderPtr_->canExportKernelTLSKeys())
+        return;
+    if (!KernelTLS::enable(socket_.fd()))
+        return;
+    KernelTLSKeys tx, rx;
+    if (!tlsProviderPtr_->exportKernelTLSKeys(canTx ? &tx : nullptr,
+                                              canRx ? &rx : nullptr))
+        return;
+    // Nothing handles an exported direction whose keys the kernel rejects.
+    if (tx.cipher != 0)
+    {
+        if (!KernelTLS::setKeys(socket_.fd(), true, tx))
+        {
+            LOG_ERROR << "[" << name()
+                      << "] - failed to install the kernel TLS tx keys";
+            forceClose();
+            return;
+        }
+        kernelTLSTx_ = true;
+    }
+    if (rx.cipher != 0)
+    {
+        if (!KernelTLS::setKeys(socket_.fd(), false, rx))
+        {
+            LOG_ERROR << "[" << name()
+                      << "] - failed to install the kernel TLS rx keys";
+            forceClose();
+            return;
+        }
+        kernelTLSRx_ = true;
+    }
+    LOG_TRACE << "[" << name() << "] - kernel TLS tx: " << kernelTLSTx_
+              << " rx: " << kernelTLSRx_;
+#endif
+}
+
+void TcpConnectionImpl::closeTLS()
+{
+#ifdef __linux__
+    if (kernelTLSTx_)
+    {
+        // close_notify alert
+        const unsigned char alert[2] = {1, 0};
+        KernelTLS::sendRecord(socket_.fd(),
+                              KernelTLS::kRecordAlert,
+                              alert,
+                              sizeof(alert));
+        return;
+    }
+#endif
+    tlsProviderPtr_->close();
+}
+
+bool TcpConnectionImpl::readKernelTLSRecord()
+{
+#ifdef __linux__
+    char buf[16 * 1024 + 256];
+    uint8_t type = 0;
+    auto n = KernelTLS::recvRecord(socket_.fd(), type, buf, sizeof(buf));
+    if (n < 0)
+        return isEAGAIN();
+    // A close_notify or fatal alert ends the connection.
+    if (type == KernelTLS::kRecordAlert && n >= 2 &&
+        (buf[0] == 2 || buf[1] == 0))
+    {
+        LOG_TRACE << "[" << name() << "] - TLS alert " << (int)buf[1]
+                  << " received";
+        return false;
+    }
+    if (type == KernelTLS::kRecordHandshake)
+    {
+        // Session tickets are not used. The other post handshake messages,
+        // a KeyUpdate in particular, change the keys, which the kernel can't
+        // follow without the provider: the next record would fail to
+        // decrypt.
+        for (ssize_t pos = 0; pos + 4 <= n;)
+        {
+            auto msgType = static_cast<uint8_t>(buf[pos]);
+            if (msgType != KernelTLS::kHandshakeNewSessionTicket)
+            {
+                LOG_ERROR << "[" << name() << "] - TLS handshake message "
+                          << (int)msgType
+                          << (msgType == KernelTLS::kHandshakeKeyUpdate
+                                  ? " (KeyUpdate)"
+                                  : "")
+                          << " received with kernel TLS, close the "
+                             "connection";
+                return false;
+            }
+            pos += 4 + ((static_cast<uint8_t>(buf[pos + 1]) << 16) |
+                        (static_cast<uint8_t>(buf[pos + 2]) << 8) |
+                        static_cast<uint8_t>(buf[pos + 3]));
+        }
+        return true;
+    }
+    LOG_TRACE << "[" << name() << "] - TLS record of type " << (int)type
+              << " ignored";
+    return true;
+#else
+    return false;
+#endif
+}
+
 void TcpConnectionImpl::onSslMessage(TcpConnection *self, MsgBuffer *buffer)
 {
-    if (self->recvMsgCallback_)
-        self->recvMsgCallback_(((TcpConnectionImpl *)self)->shared_from_this(),
-                               buffer);
+    ((TcpConnectionImpl *)self)->handleRecvData(buffer);
 }
 ssize_t TcpConnectionImpl::onSslWrite(TcpConnection *self,
                                       const void *data,
@@ -821,38 +1940,112 @@ void TcpConnectionImpl::onSslCloseAlert(TcpConnection *self)
 {
     self->shutdown();
 }
+// The flow control state of an async stream, shared by the stream and its
+// buffer node.
+struct AsyncStreamFlow
+{
+    // Bytes accepted by send() and not yet written to the socket.
+    std::atomic<size_t> queuedBytes{0};
+    std::atomic<size_t> highWaterMark{0};
+    std::atomic<size_t> lowWaterMark{0};
+    // True when a producer waits for the stream to become writable.
+    std::atomic<bool> blocked{false};
+    std::mutex mutex;
+    std::function<void()> writableCallback;
+
+    bool isWritable()
+    {
+        auto high = highWaterMark.load();
+        if (high == 0 || queuedBytes.load() < high)
+            return true;
+        blocked = true;
+        // Check again in case the loop drained the stream meanwhile.
+        if (queuedBytes.load() < high)
+            return true;
+        return false;
+    }
+    // Called in the loop thread.
+    void drained(size_t len)
+    {
+        if (len == 0)
+            return;
+        auto queued = queuedBytes.fetch_sub(len) - len;
+        if (!blocked || queued > lowWaterMark.load())
+            return;
+        blocked = false;
+        std::function<void()> callback;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            callback = writableCallback;
+        }
+        if (callback)
+            callback();
+    }
+};
+
 class AsyncStreamImpl : public AsyncStream
 {
 public:
-    explicit AsyncStreamImpl(std::function<bool(const char *, size_t)> callback)
-        : callback_(std::move(callback))
+    AsyncStreamImpl(
+        std::function<bool(const char *, size_t, std::string *)> callback,
+        std::shared_ptr<AsyncStreamFlow> flow)
+        : callback_(std::move(callback)), flow_(std::move(flow))
     {
     }
     AsyncStreamImpl() = delete;
     bool send(const char *data, size_t len) override
     {
-        return callback_(data, len);
+        if (!callback_ || !flow_->isWritable())
+            return false;
+        return callback_(data, len, nullptr);
+    }
+    bool send(std::string &&data) override
+    {
+        if (!callback_ || !flow_->isWritable())
+            return false;
+        return callback_(data.data(), data.size(), &data);
+    }
+    void setWaterMarks(size_t highWaterMark, size_t lowWaterMark) override
+    {
+        assert(lowWaterMark <= highWaterMark || highWaterMark == 0);
+        flow_->lowWaterMark = lowWaterMark;
+        flow_->highWaterMark = highWaterMark;
+    }
+    bool isWritable() const override
+    {
+        return callback_ && flow_->isWritable();
+    }
+    void setWritableCallback(std::function<void()> callback) override
+    {
+        std::lock_guard<std::mutex> lock(flow_->mutex);
+        flow_->writableCallback = std::move(callback);
     }
     void close() override
     {
-        callback_(nullptr, 0);
+        if (!callback_)
+            return;
+        callback_(nullptr, 0, nullptr);
         callback_ = nullptr;
+        setWritableCallback(nullptr);
     }
     ~AsyncStreamImpl() override
     {
-        if (callback_)
-            callback_(nullptr, 0);
+        close();
     }
 
 private:
-    std::function<bool(const char *, size_t)> callback_;
+    std::function<bool(const char *, size_t, std::string *)> callback_;
+    std::shared_ptr<AsyncStreamFlow> flow_;
 };
 AsyncStreamPtr TcpConnectionImpl::sendAsyncStream(bool disableKickoff)
 {
-    auto asyncStreamNode = BufferNode::newAsyncStreamBufferNode();
+    auto flow = std::make_shared<AsyncStreamFlow>();
+    auto asyncStreamNode = BufferNode::newAsyncStreamBufferNode(
+        [flow](size_t len) { flow->drained(len); });
     std::weak_ptr<TcpConnectionImpl> weakPtr = shared_from_this();
     auto asyncStream = std::make_unique<AsyncStreamImpl>(
-        [asyncStreamNode, weakPtr = std::move(weakPtr)](const char *data, size_t len) -> bool
+        [asyncStreamNode, flow, weakPtr = std::move(weakPtr)](
+            const char *data, size_t len, std::string *owned) -> bool
         {
             auto thisPtr = weakPtr.lock();
             if (!thisPtr)
@@ -865,21 +2058,30 @@ AsyncStreamPtr TcpConnectionImpl::sendAsyncStream(bool disableKickoff)
                 LOG_DEBUG << "Connection is not connected,give up sending";
                 return false;
             }
+            if (data)
+                flow->queuedBytes += len;
             if (thisPtr->loop_->isInLoopThread())
             {
-                thisPtr->sendAsyncDataInLoop(asyncStreamNode, data, len);
+                if (owned)
+                    thisPtr->sendAsyncDataInLoop(asyncStreamNode,
+                                                 std::move(*owned));
+                else
+                    flow->drained(thisPtr->sendAsyncDataInLoop(asyncStreamNode,
+                                                               data,
+                                                               len));
             }
             else
             {
                 if (data)
                 {
-                    std::string buffer(data, len);
+                    // Hand owned buffers over without copying them.
+                    std::string buffer =
+                        owned ? std::move(*owned) : std::string(data, len);
                     thisPtr->loop_->queueInLoop([thisPtr,
                                                  asyncStreamNode,
-                                                 buffer = std::move(buffer)]()
+                                                 buffer = std::move(buffer)]() mutable
                                                 { thisPtr->sendAsyncDataInLoop(asyncStreamNode,
-                                                                               buffer.data(),
-                                                                               buffer.length()); });
+                                                                               std::move(buffer)); });
                 }
                 else
                 {
@@ -890,7 +2092,8 @@ AsyncStreamPtr TcpConnectionImpl::sendAsyncStream(bool disableKickoff)
                 }
             }
             return true;
-        });
+        },
+        flow);
     if (loop_->isInLoopThread())
     {
         if (disableKickoff)
@@ -930,18 +2133,37 @@ AsyncStreamPtr TcpConnectionImpl::sendAsyncStream(bool disableKickoff)
             {
                 auto n = thisPtr->sendNodeInLoop(node);
                 if (n >= 0 && (node->remainingBytes() > 0 || node->available()))
+                {
+                    thisPtr->addQueuedBytes(node->remainingBytes());
                     thisPtr->writeBufferList_.push_back(std::move(node));
+                }
             }
             else
             {
+                thisPtr->addQueuedBytes(node->remainingBytes());
                 thisPtr->writeBufferList_.push_back(std::move(node));
             } });
     }
     return asyncStream;
 }
 void TcpConnectionImpl::sendAsyncDataInLoop(const BufferNodePtr &node,
-                                            const char *data,
-                                            size_t len)
+                                            std::string &&data)
+{
+    loop_->assertInLoopThread();
+    bool idle = !writeBufferList_.empty() && node == writeBufferList_.front() &&
+                node->remainingBytes() == 0;
+    addQueuedBytes(static_cast<long long>(data.size()));
+    node->append(std::move(data));
+    if (idle && node->remainingBytes() > 0)
+    {
+        auto sentBefore = bytesSent_;
+        sendNodeInLoop(node);
+        removeQueuedBytes(bytesSent_ - sentBefore);
+    }
+}
+size_t TcpConnectionImpl::sendAsyncDataInLoop(const BufferNodePtr &node,
+                                              const char *data,
+                                              size_t len)
 {
     loop_->assertInLoopThread();
     if (data)
@@ -955,16 +2177,19 @@ void TcpConnectionImpl::sendAsyncDataInLoop(const BufferNodePtr &node,
                 if (nWritten < 0)
                 {
                     LOG_TRACE << "write error";
-                    return;
+                    return 0;
                 }
                 if (static_cast<size_t>(nWritten) < len)
                 {
                     node->append(data + nWritten, len - nWritten);
+                    addQueuedBytes(static_cast<long long>(len - nWritten));
                 }
+                return static_cast<size_t>(nWritten);
             }
             else
             {
                 node->append(data, len);
+                addQueuedBytes(static_cast<long long>(len));
             }
         }
     }
@@ -973,8 +2198,8 @@ void TcpConnectionImpl::sendAsyncDataInLoop(const BufferNodePtr &node,
         // stream is closed
         node->done();
         if (!writeBufferList_.empty() && node == writeBufferList_.front() &&
-            !ioChannelPtr_->isWriting())
-            ioChannelPtr_->enableWriting();
+            !ioChannel_.isWriting())
+            ioChannel_.enableWriting();
 
         if (idleTimeoutBackup_ > 0)
         {
@@ -989,4 +2214,5 @@ void TcpConnectionImpl::sendAsyncDataInLoop(const BufferNodePtr &node,
             }
         }
     }
+    return 0;
 }
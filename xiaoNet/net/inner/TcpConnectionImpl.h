@@ -11,16 +11,18 @@
 #pragma once
 
 #include <xiaoNet/net/TcpConnection.h>
+#include <xiaoNet/net/Channel.h>
+#include <xiaoNet/net/inner/Socket.h>
 #include <xiaoNet/utils/MsgBuffer.h>
 #include <xiaoNet/net/inner/BufferNode.h>
+#include <xiaoNet/net/inner/BufferNodeQueue.h>
 #include <xiaoNet/net/inner/TLSProvider.h>
 #include <xiaoNet/utils/TimingWheel.h>
-#include <list>
+#include <atomic>
+#include <deque>
 
 namespace xiaoNet
 {
-    class Channel;
-    class Socket;
     class TcpServer;
     class TcpConnectionImpl : public TcpConnection,
                               public NonCopyable,
@@ -28,6 +30,7 @@ namespace xiaoNet
     {
         friend class TcpServer;
         friend class TcpClient;
+        friend class TcpConnectionPool;
 
     public:
         class KickoffEntry
@@ -60,15 +63,30 @@ namespace xiaoNet
                           const InetAddress &peerAddr,
                           TLSPolicyPtr policy = nullptr,
                           SSLContextPtr ctx = nullptr);
+        /**
+         * @brief Construct a connection reading into the given buffer, e.g.
+         * one recycled from a closed connection.
+         */
+        TcpConnectionImpl(EventLoop *loop,
+                          int socketfd,
+                          const InetAddress &localAddr,
+                          const InetAddress &peerAddr,
+                          MsgBuffer &&readBuffer,
+                          TLSPolicyPtr policy = nullptr,
+                          SSLContextPtr ctx = nullptr);
         ~TcpConnectionImpl() override;
+        using TcpConnection::send;
         void send(const char *msg, size_t len) override;
         void send(const void *msg, size_t len) override;
         void send(const std::string &msg) override;
         void send(std::string &&msg) override;
+        using TcpConnection::sendControl;
+        void sendControl(const char *msg, size_t len) override;
         void send(const MsgBuffer &buffer) override;
         void send(MsgBuffer &&buffer) override;
         void send(const std::shared_ptr<std::string> &msgPtr) override;
         void send(const std::shared_ptr<MsgBuffer> &msgPtr) override;
+        void send(const ConstBuffer *buffers, size_t count) override;
         void sendFile(const char *fileName,
                       long long offset,
                       long long length) override;
@@ -76,7 +94,11 @@ namespace xiaoNet
                       long long offset,
                       long long length) override;
         void sendStream(
-            std::function<std::size_t(char *, std::size_t)> callbcak) override;
+            std::function<std::size_t(char *, std::size_t)> callbcak,
+            size_t chunkSize,
+            long long length) override;
+        void sendFromFd(int fd, size_t length) override;
+        void forwardTo(const TcpConnectionPtr &target) override;
 
         const InetAddress &localAddr() const override
         {
@@ -102,6 +124,14 @@ namespace xiaoNet
             highWaterMarkCallback_ = cb;
             highWaterMarkLen_ = markLen;
         }
+        void setLowWaterMarkCallback(const LowWaterMarkCallback &cb,
+                                     size_t markLen) override
+        {
+            lowWaterMarkCallback_ = cb;
+            lowWaterMarkLen_ = markLen;
+        }
+        void pauseReading() override;
+        void resumeReading() override;
 
         void keepAlive() override
         {
@@ -117,6 +147,19 @@ namespace xiaoNet
             return idleTimeout_ == 0;
         }
         void setTcpNoDelay(bool on) override;
+        bool setBusyPoll(int usec) override;
+        bool setIncomingCpu(int cpu) override;
+        bool setRecvBufferSize(int bytes) override;
+        bool setSendBufferSize(int bytes) override;
+        bool setQuickAck(bool on) override;
+        bool setUserTimeout(unsigned int ms) override;
+        void setSocketPolicy(const SocketPolicy &policy) override;
+        void setAutoBatch(bool on) override;
+        void flush() override;
+        void setZeroCopyThreshold(size_t threshold) override;
+        void setAsyncPrefetch(bool on) override;
+        void setFileCacheHints(bool readahead, bool dropBehind) override;
+        void setNotSentLowWaterMark(size_t bytes) override;
         void shutdown() override;
         void forceClose() override;
         EventLoop *getLoop() override
@@ -132,6 +175,39 @@ namespace xiaoNet
         {
             return bytesReceived_;
         }
+        size_t bytesQueued() const override
+        {
+            return bytesQueued_;
+        }
+        size_t memoryUsage() const override
+        {
+            return memoryUsage_;
+        }
+        /**
+         * @brief Return the part of memoryUsage() held by the sending buffer
+         * and the outgoing TLS data, it drains as the peer reads.
+         */
+        size_t sendMemoryUsage() const
+        {
+            return sendMemoryUsage_;
+        }
+        /**
+         * @brief Pause or resume reading for the memory budget of the server.
+         * It's independent of pauseReading() and resumeReading() and of the
+         * pauses of forwardTo(), reading resumes when none pauses it.
+         */
+        void setReadingPausedByServer(bool paused);
+        /**
+         * @brief Set the counters the memory usage of the connection is added
+         * to, e.g. the totals of its loop and of its server.
+         */
+        void setMemoryCounters(
+            std::shared_ptr<std::atomic<size_t>> loopCounter,
+            std::shared_ptr<std::atomic<size_t>> serverCounter)
+        {
+            loopMemoryCounter_ = std::move(loopCounter);
+            serverMemoryCounter_ = std::move(serverCounter);
+        }
 
         bool isSSLConnection() const override
         {
@@ -142,7 +218,8 @@ namespace xiaoNet
 
         MsgBuffer *getRecvBuffer() override
         {
-            if (tlsProviderPtr_)
+            // With kernel TLS, the decrypted data is read into readBuffer_.
+            if (tlsProviderPtr_ && !kernelTLSRx_)
                 return &tlsProviderPtr_->getRecvBuffer();
             return &readBuffer_;
         }
@@ -195,7 +272,9 @@ namespace xiaoNet
         size_t idleTimeoutBackup_{0};
         Date lastTimingWheelUpdateTime_;
         void extendLife();
+        void popWriteBufferFront();
         void sendFile(BufferNodePtr &&fileNode);
+        void sendFileOrStreamInLoop(BufferNodePtr &&node);
 
     protected:
         enum class ConnStatus
@@ -206,30 +285,149 @@ namespace xiaoNet
             Disconnecting
         };
         EventLoop *loop_;
-        std::unique_ptr<Channel> ioChannelPtr_;
-        std::unique_ptr<Socket> socketPtr_;
+        // Held by value, they are allocated with the connection (e.g. from
+        // the TcpConnectionPool).
+        Channel ioChannel_;
+        Socket socket_;
         MsgBuffer readBuffer_;
-        std::list<BufferNodePtr> writeBufferList_;
+        BufferNodeQueue writeBufferList_;
         void readCallback();
         void writeCallback();
+        void handleRecvData(MsgBuffer *buffer);
         InetAddress localAddr_, peerAddr_;
         ConnStatus status_{ConnStatus::Connecting};
         void handleClose();
         void handleError();
-        void sendAsyncDataInLoop(const BufferNodePtr &node,
-                                 const char *data,
-                                 size_t len);
+        // Returns the number of bytes written without being queued.
+        size_t sendAsyncDataInLoop(const BufferNodePtr &node,
+                                   const char *data,
+                                   size_t len);
+        void sendAsyncDataInLoop(const BufferNodePtr &node, std::string &&data);
         ssize_t sendNodeInLoop(const BufferNodePtr &node);
 #ifndef _WIN32
         void sendInLoop(const void *buffer, size_t length);
+        void sendInLoop(const ConstBuffer *buffers, size_t count);
         ssize_t writeRaw(const void *buffer, size_t length);
+        ssize_t writevRaw(const struct iovec *vecs, int count);
+        bool sendMemNodesInLoop();
         ssize_t writeInLoop(const void *buffer, size_t length);
 #else
         void sendInLoop(const char *buffer, size_t length);
         ssize_t wrtieRaw(const char *buffer, size_t length);
         ssize_t writeInLoop(const void *buffer, size_t length);
 #endif
+        void appendToWriteBuffer(const char *data, size_t length);
+        // Appends the buffers from offset bytes in the first one.
+        void appendToWriteBuffer(const ConstBuffer *buffers,
+                                 size_t count,
+                                 size_t offset);
+        void sendControlInLoop(const char *data, size_t length);
+        // The control messages queued ahead of the other nodes are before
+        // this index in writeBufferList_, 0 if there is none.
+        size_t controlEnd_{0};
+        // The bytes of the control messages that jumped ahead since the last
+        // time there was none.
+        size_t controlBytesAhead_{0};
+        // The index of the last control message queued as usual because of
+        // the cap, the next ones must not overtake it. 0 if there is none.
+        size_t controlBehind_{0};
+        bool sendWriteBufferInLoop();
+        bool drainWriteBufferInLoop();
+        void flushInLoop();
+        bool autoBatch_{false};
+        bool flushPending_{false};
+        void scheduleFlush();
+        void scheduleWriteComplete();
+        bool writeCompletePending_{false};
+
+        void sendInLoop(std::string &&msg);
+        void sendInLoop(MsgBuffer &&buffer);
+        void sendInLoop(const std::shared_ptr<std::string> &msgPtr);
+        void sendInLoop(const std::shared_ptr<MsgBuffer> &msgPtr);
+        bool zeroCopyEligible(size_t length) const
+        {
+            return zeroCopyThreshold_ > 0 && length >= zeroCopyThreshold_ &&
+                   !tlsProviderPtr_;
+        }
+        void sendZeroCopyInLoop(std::shared_ptr<void> &&owner,
+                                const char *data,
+                                size_t length);
+        void handleZeroCopyCompletions();
+        void sendOrQueueNodeInLoop(BufferNodePtr &&node);
+        void resumeWritingInLoop();
+        bool asyncPrefetch_{false};
+        // Read by sendFile() in the calling thread.
+        std::atomic<uint8_t> fileCacheHints_{BufferNode::kFileReadahead};
+        // The TCP_NOTSENT_LOWAT of the socket, 0 if not set. The bytes written
+        // to the socket are then limited to it per writable event, the budget
+        // is refilled when the socket is reported writable.
+        size_t notSentLowWaterMark_{0};
+        size_t writeBudget_{0};
+        // Return the number of the given bytes that may be written now.
+        size_t writableLength(size_t length) const
+        {
+            return notSentLowWaterMark_ > 0 && length > writeBudget_
+                       ? writeBudget_
+                       : length;
+        }
+        void consumeWriteBudget(size_t n)
+        {
+            if (notSentLowWaterMark_ > 0)
+                writeBudget_ -= n < writeBudget_ ? n : writeBudget_;
+        }
+
+        void forwardInLoop();
+        void resumeForwardSource();
+        // The connection receiving the data read from this one.
+        std::weak_ptr<TcpConnectionImpl> forwardTarget_;
+        // The connection paused until this one drains its sending buffer.
+        std::weak_ptr<TcpConnectionImpl> forwardSource_;
+
+        void enableKernelTLSInLoop();
+        void closeTLS();
+        bool readKernelTLSRecord();
+        // True if the data is encrypted by the TLS provider in user space.
+        bool encryptsInUserSpace() const
+        {
+            return tlsProviderPtr_ && !kernelTLSTx_;
+        }
+        bool kernelTLSTx_{false};
+        bool kernelTLSRx_{false};
+        size_t zeroCopyThreshold_{0};
+        bool zeroCopyEnabled_{false};
+        // Sequence number of the next MSG_ZEROCOPY send.
+        uint32_t zeroCopySeq_{0};
+        // Number of MSG_ZEROCOPY sends reported complete by the kernel.
+        uint32_t zeroCopyAcked_{0};
+        // Nodes that are fully sent but still referenced by the kernel, with
+        // the sequence number of their last send.
+        std::deque<std::pair<uint32_t, BufferNodePtr>> zeroCopyPending_;
         size_t highWaterMarkLen_{0};
+        size_t lowWaterMarkLen_{0};
+        // True when the buffered bytes exceeded the low water mark.
+        bool lowWaterMarkArmed_{false};
+        bool readingPaused_{false};
+        bool readingPausedByServer_{false};
+        // Set while the target of forwardTo() drains what was forwarded.
+        bool readingPausedByForward_{false};
+        void updateReading();
+        // The bytes in writeBufferList_.
+        size_t bytesQueued_{0};
+        // The part of bytesQueued_ in nodes not holding their data in memory
+        // (files, pipes and streams producing their data when sent).
+        size_t queuedFdBytes_{0};
+        void addQueuedBytes(long long n);
+        void removeQueuedBytes(size_t n);
+        void removeQueuedFdBytes(ssize_t n);
+        void updateMemoryUsage();
+        void setMemoryUsage(size_t usage, size_t sendUsage);
+        // Written in the loop thread only, read from any thread.
+        std::atomic<size_t> memoryUsage_{0};
+        std::atomic<size_t> sendMemoryUsage_{0};
+        std::shared_ptr<std::atomic<size_t>> loopMemoryCounter_;
+        std::shared_ptr<std::atomic<size_t>> serverMemoryCounter_;
+        // Built on first use, it's only needed for logging.
+        const std::string &name();
         std::string name_;
 
         size_t bytesSent_{0};
@@ -0,0 +1,149 @@
+/**
+ * @file TcpConnectionPool.cpp
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief
+ * @version 0.1
+ * @date 2025-01-10
+ *
+ *
+ */
+
+#include "TcpConnectionPool.h"
+#include <type_traits>
+
+using namespace xiaoNet;
+
+// Read buffers that grew larger than this are freed rather than pooled, the
+// pool would otherwise keep their peak size.
+static const size_t kMaxPooledReadBufferSize = 16 * 1024;
+
+namespace
+{
+    // Allocates the connections made by allocate_shared() from the pool and
+    // hands their read buffers back to the pool when they are destroyed.
+    template <typename T>
+    class PoolAllocator
+    {
+    public:
+        using value_type = T;
+
+        explicit PoolAllocator(std::shared_ptr<TcpConnectionPool> pool)
+            : pool_(std::move(pool))
+        {
+        }
+        template <typename U>
+        PoolAllocator(const PoolAllocator<U> &other) : pool_(other.pool_)
+        {
+        }
+
+        T *allocate(size_t n)
+        {
+            return static_cast<T *>(pool_->allocate(n * sizeof(T)));
+        }
+        void deallocate(T *p, size_t n)
+        {
+            pool_->deallocate(p, n * sizeof(T));
+        }
+        template <typename U>
+        void destroy(U *p)
+        {
+            if constexpr (std::is_same_v<U, TcpConnectionImpl>)
+                pool_->recycle(p);
+            p->~U();
+        }
+
+        template <typename U>
+        bool operator==(const PoolAllocator<U> &other) const
+        {
+            return pool_ == other.pool_;
+        }
+        template <typename U>
+        bool operator!=(const PoolAllocator<U> &other) const
+        {
+            return pool_ != other.pool_;
+        }
+
+    private:
+        template <typename U>
+        friend class PoolAllocator;
+        std::shared_ptr<TcpConnectionPool> pool_;
+    };
+}  // namespace
+
+TcpConnectionPool::~TcpConnectionPool()
+{
+    for (auto block : blocks_)
+        ::operator delete(block);
+}
+
+std::shared_ptr<TcpConnectionImpl> TcpConnectionPool::newConnection(
+    EventLoop *loop,
+    int socketfd,
+    const InetAddress &localAddr,
+    const InetAddress &peerAddr,
+    TLSPolicyPtr policy,
+    SSLContextPtr ctx)
+{
+    return std::allocate_shared<TcpConnectionImpl>(
+        PoolAllocator<TcpConnectionImpl>(shared_from_this()),
+        loop,
+        socketfd,
+        localAddr,
+        peerAddr,
+        takeReadBuffer(),
+        std::move(policy),
+        std::move(ctx));
+}
+
+void *TcpConnectionPool::allocate(size_t size)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (blockSize_ == 0)
+            blockSize_ = size;
+        if (size == blockSize_ && !blocks_.empty())
+        {
+            auto block = blocks_.back();
+            blocks_.pop_back();
+            return block;
+        }
+    }
+    return ::operator new(size);
+}
+
+void TcpConnectionPool::deallocate(void *block, size_t size)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (size == blockSize_ && blocks_.size() < capacity_)
+        {
+            blocks_.push_back(block);
+            return;
+        }
+    }
+    ::operator delete(block);
+}
+
+void TcpConnectionPool::recycle(TcpConnectionImpl *conn)
+{
+    if (conn->readBuffer_.capacity() > kMaxPooledReadBufferSize)
+        return;
+    conn->readBuffer_.retrieveAll();
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (readBuffers_.size() < capacity_)
+        readBuffers_.push_back(std::move(conn->readBuffer_));
+}
+
+MsgBuffer TcpConnectionPool::takeReadBuffer()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!readBuffers_.empty())
+        {
+            MsgBuffer buffer(std::move(readBuffers_.back()));
+            readBuffers_.pop_back();
+            return buffer;
+        }
+    }
+    return MsgBuffer();
+}
@@ -0,0 +1,67 @@
+/**
+ * @file TcpConnectionPool.h
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief
+ * @version 0.1
+ * @date 2025-01-10
+ *
+ *
+ */
+
+#pragma once
+
+#include <xiaoNet/net/inner/TcpConnectionImpl.h>
+#include <xiaoNet/utils/NonCopyable.h>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace xiaoNet
+{
+    /**
+     * @brief A pool recycling the memory of closed connections. A connection
+     * made by the pool is allocated in a block released by a previous one
+     * (the object together with its shared_ptr control block) and reads into
+     * the buffer of a previous one, so accepting a connection doesn't go
+     * through the heap for them.
+     * @note The TcpServer keeps one pool per I/O loop. Connections are made in
+     * the loop of the server and released in any thread, the pool is thread
+     * safe.
+     */
+    class TcpConnectionPool
+        : public NonCopyable,
+          public std::enable_shared_from_this<TcpConnectionPool>
+    {
+    public:
+        /**
+         * @param capacity The maximum number of blocks and of buffers kept.
+         */
+        explicit TcpConnectionPool(size_t capacity = 1024)
+            : capacity_(capacity)
+        {
+        }
+        ~TcpConnectionPool();
+
+        std::shared_ptr<TcpConnectionImpl> newConnection(
+            EventLoop *loop,
+            int socketfd,
+            const InetAddress &localAddr,
+            const InetAddress &peerAddr,
+            TLSPolicyPtr policy = nullptr,
+            SSLContextPtr ctx = nullptr);
+
+        void *allocate(size_t size);
+        void deallocate(void *block, size_t size);
+        void recycle(TcpConnectionImpl *conn);
+
+    private:
+        MsgBuffer takeReadBuffer();
+
+        const size_t capacity_;
+        std::mutex mutex_;
+        // All blocks have the same size, the one of the first allocation.
+        size_t blockSize_{0};
+        std::vector<void *> blocks_;
+        std::vector<MsgBuffer> readBuffers_;
+    };
+}  // namespace xiaoNet
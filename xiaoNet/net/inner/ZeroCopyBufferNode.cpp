@@ -0,0 +1,61 @@
+/**
+ * @file ZeroCopyBufferNode.cpp
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief
+ * @version 0.1
+ * @date 2025-01-11
+ *
+ *
+ */
+
+#include <xiaoNet/net/inner/BufferNode.h>
+
+namespace xiaoNet
+{
+    class ZeroCopyBufferNode : public BufferNode
+    {
+    public:
+        ZeroCopyBufferNode(std::shared_ptr<void> &&owner,
+                           const char *data,
+                           size_t len)
+            : BufferNode(kZeroCopy),
+              owner_(std::move(owner)),
+              data_(data),
+              len_(len)
+        {
+        }
+        void getData(const char *&data, size_t &len) override
+        {
+            data = data_;
+            len = len_;
+        }
+        void retrieve(size_t len) override
+        {
+            assert(len <= len_);
+            data_ += len;
+            len_ -= len;
+        }
+        long long remainingBytes() const override
+        {
+            if (isDone_)
+                return 0;
+            return static_cast<long long>(len_);
+        }
+
+    private:
+        // Keeps the memory alive until the kernel reports that it is no
+        // longer referenced.
+        std::shared_ptr<void> owner_;
+        const char *data_;
+        size_t len_;
+    };
+    BufferNodePtr BufferNode::newZeroCopyBufferNode(
+        std::shared_ptr<void> &&owner,
+        const char *data,
+        size_t len)
+    {
+        return std::make_shared<ZeroCopyBufferNode>(std::move(owner),
+                                                    data,
+                                                    len);
+    }
+}
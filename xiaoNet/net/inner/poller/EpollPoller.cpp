@@ -11,6 +11,7 @@
 #include <xiaoLog/Logger.h>
 #include "EpollPoller.h"
 #include "Channel.h"
+#include "HotPathLog.h"
 #ifdef __linux__
 #include <poll.h>
 #include <sys/epoll.h>
@@ -74,7 +75,7 @@ namespace xiaoNet
 
         if (numEvents > 0)
         {
-            LOG_DEBUG << "numEvents: " << numEvents << ", epollfd: " << epollfd_;
+            LOG_DEBUG_HOT << "numEvents: " << numEvents << ", epollfd: " << epollfd_;
             fillActiveChannels(numEvents, activeChannels);
             if (static_cast<size_t>(numEvents) == events_.size())
             {
@@ -83,7 +84,7 @@ namespace xiaoNet
         }
         else if (numEvents == 0)
         {
-            LOG_DEBUG << "nothing happended, epollfd: " << epollfd_;
+            LOG_DEBUG_HOT << "nothing happended, epollfd: " << epollfd_;
             // std::cout << "nothing happended" << std::endl;
         }
         else
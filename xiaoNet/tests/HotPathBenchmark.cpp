@@ -0,0 +1,98 @@
+#include <xiaoNet/net/TcpServer.h>
+#include <xiaoNet/net/TcpClient.h>
+#include <xiaoLog/Logger.h>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+using namespace xiaoNet;
+
+// Counts the heap allocations of the process, the string formatting of the
+// logs and of the connection names allocates.
+static std::atomic<long long> allocations{0};
+
+void *operator new(size_t size)
+{
+    ++allocations;
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+void operator delete(void *p, size_t) noexcept
+{
+    std::free(p);
+}
+
+// Bounces a small message between a client and an echo server and reports
+// the time and the heap allocations per round trip once the connection is
+// warmed up. With the default build options the hot path does no string
+// work, so no allocation is expected.
+int main()
+{
+    xiaoLog::Logger::setLogLevel(xiaoLog::Logger::kWarn);
+    const int kWarmup = 1000;
+    const int kRoundTrips = 100000;
+    const std::string message(64, 'x');
+
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress("127.0.0.1", 0), "benchserver");
+    server.setRecvMessageCallback(
+        [](const TcpConnectionPtr &conn, MsgBuffer *buffer)
+        {
+            conn->send(buffer->peek(), buffer->readableBytes());
+            buffer->retrieveAll();
+        });
+    server.start();
+
+    auto client = std::make_shared<TcpClient>(&loop,
+                                              server.address(),
+                                              "benchclient");
+    int roundTrips = 0;
+    long long startAllocations = 0;
+    std::chrono::steady_clock::time_point start;
+    client->setMessageCallback(
+        [&](const TcpConnectionPtr &conn, MsgBuffer *buffer)
+        {
+            if (buffer->readableBytes() < message.size())
+                return;
+            buffer->retrieve(message.size());
+            ++roundTrips;
+            if (roundTrips == kWarmup)
+            {
+                startAllocations = allocations;
+                start = std::chrono::steady_clock::now();
+            }
+            else if (roundTrips == kWarmup + kRoundTrips)
+            {
+                loop.quit();
+                return;
+            }
+            conn->send(message.data(), message.size());
+        });
+    client->setConnectionCallback(
+        [&](const TcpConnectionPtr &conn)
+        {
+            if (conn->connected())
+                conn->send(message.data(), message.size());
+        });
+    client->connect();
+    loop.loop();
+
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    auto allocated = allocations - startAllocations;
+    std::cout << kRoundTrips << " round trips of " << message.size()
+              << " bytes: "
+              << std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed)
+                         .count() /
+                     kRoundTrips
+              << " ns per round trip, "
+              << static_cast<double>(allocated) / kRoundTrips
+              << " allocations per round trip" << std::endl;
+    return 0;
+}
@@ -0,0 +1,91 @@
+#include <xiaoNet/net/TcpServer.h>
+#include <xiaoNet/net/TcpClient.h>
+#include <xiaoLog/Logger.h>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+using namespace xiaoNet;
+
+// Queues 10k small nodes on a connection, alternating memory and stream
+// nodes so that they are not merged, and measures the time until the write
+// buffer is drained and the write complete callback is called.
+int main()
+{
+    xiaoLog::Logger::setLogLevel(xiaoLog::Logger::kWarn);
+    const int kNodes = 10000;
+    const int kRounds = 50;
+    const size_t kNodeSize = 64;
+
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress("127.0.0.1", 0), "benchserver");
+    size_t received = 0;
+    server.setRecvMessageCallback(
+        [&received](const TcpConnectionPtr &, MsgBuffer *buffer)
+        {
+            received += buffer->readableBytes();
+            buffer->retrieveAll();
+        });
+    server.start();
+
+    auto client = std::make_shared<TcpClient>(&loop,
+                                              server.address(),
+                                              "benchclient");
+    std::string chunk(kNodeSize, 'x');
+    int round = 0;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::nanoseconds total{0};
+    std::function<void(const TcpConnectionPtr &)> queueRound =
+        [&](const TcpConnectionPtr &conn)
+    {
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < kNodes / 2; ++i)
+        {
+            conn->send(chunk);
+            conn->sendStream(
+                [sent = false, &chunk](char *buf, size_t len) mutable -> size_t
+                {
+                    if (!buf || sent || len < chunk.size())
+                        return 0;
+                    sent = true;
+                    memcpy(buf, chunk.data(), chunk.size());
+                    return chunk.size();
+                },
+                kNodeSize,
+                kNodeSize);
+        }
+    };
+    client->setWriteCompleteCallback(
+        [&](const TcpConnectionPtr &conn)
+        {
+            total += std::chrono::steady_clock::now() - start;
+            if (++round == kRounds)
+            {
+                loop.quit();
+                return;
+            }
+            queueRound(conn);
+        });
+    client->setConnectionCallback(
+        [&](const TcpConnectionPtr &conn)
+        {
+            if (!conn->connected())
+                return;
+            // Queue the whole round, it's drained at the end of the loop
+            // iteration.
+            conn->setAutoBatch(true);
+            queueRound(conn);
+        });
+    client->connect();
+    loop.loop();
+
+    std::cout << kRounds << " rounds of " << kNodes << " nodes: "
+              << std::chrono::duration_cast<std::chrono::microseconds>(total)
+                         .count() /
+                     kRounds
+              << " us per round, "
+              << total.count() / (static_cast<long long>(kRounds) * kNodes)
+              << " ns per node (" << received << " bytes received)"
+              << std::endl;
+    return 0;
+}
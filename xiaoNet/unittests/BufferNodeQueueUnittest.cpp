@@ -0,0 +1,108 @@
+#include <xiaoNet/net/inner/BufferNodeQueue.h>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+using namespace xiaoNet;
+
+namespace
+{
+    BufferNodePtr memNode(const std::string &content)
+    {
+        auto node = BufferNode::newMemBufferNode();
+        node->append(content.data(), content.size());
+        return node;
+    }
+    std::string contentOf(const BufferNodePtr &node)
+    {
+        const char *data;
+        size_t len;
+        node->getData(data, len);
+        return std::string(data, len);
+    }
+}  // namespace
+
+TEST(BufferNodeQueue, FifoAcrossWrapAndGrowth)
+{
+    BufferNodeQueue queue;
+    EXPECT_TRUE(queue.empty());
+    int pushed = 0;
+    int popped = 0;
+    // Interleave pushes and pops so that the ring wraps before it grows.
+    for (int round = 0; round < 50; ++round)
+    {
+        for (int i = 0; i < 3 + round % 7; ++i)
+            queue.push_back(memNode(std::to_string(pushed++)));
+        EXPECT_EQ(std::to_string(pushed - 1), contentOf(queue.back()));
+        for (size_t i = 0; i < queue.size(); ++i)
+            EXPECT_EQ(std::to_string(popped + static_cast<int>(i)),
+                      contentOf(queue[i]));
+        for (int i = 0; i < 2 + round % 5 && !queue.empty(); ++i)
+        {
+            EXPECT_EQ(std::to_string(popped++), contentOf(queue.front()));
+            queue.pop_front();
+        }
+    }
+    EXPECT_EQ(static_cast<size_t>(pushed - popped), queue.size());
+    while (!queue.empty())
+    {
+        EXPECT_EQ(std::to_string(popped++), contentOf(queue.front()));
+        queue.pop_front();
+    }
+    EXPECT_EQ(pushed, popped);
+}
+
+TEST(BufferNodeQueue, InsertShiftsFollowingNodes)
+{
+    BufferNodeQueue queue;
+    std::vector<std::string> expected;
+    // Pop first so that the ring wraps, then insert across the growth.
+    queue.push_back(memNode("dropped"));
+    queue.pop_front();
+    for (int i = 0; i < 6; ++i)
+    {
+        queue.push_back(memNode(std::to_string(i)));
+        expected.push_back(std::to_string(i));
+    }
+    queue.insert(1, memNode("a"));
+    expected.insert(expected.begin() + 1, "a");
+    queue.insert(0, memNode("b"));
+    expected.insert(expected.begin(), "b");
+    queue.insert(queue.size(), memNode("c"));
+    expected.push_back("c");
+    ASSERT_EQ(expected.size(), queue.size());
+    for (size_t i = 0; i < expected.size(); ++i)
+        EXPECT_EQ(expected[i], contentOf(queue[i]));
+}
+
+TEST(BufferNodeQueue, PopReleasesNode)
+{
+    BufferNodeQueue queue;
+    auto node = memNode("x");
+    queue.push_back(node);
+    EXPECT_EQ(2, node.use_count());
+    queue.pop_front();
+    EXPECT_EQ(1, node.use_count());
+}
+
+TEST(MemBufferNode, Recycled)
+{
+    auto node = memNode("hello");
+    auto raw = node.get();
+    node->retrieve(5);
+    BufferNode::recycleMemBufferNode(std::move(node));
+    auto reused = BufferNode::newMemBufferNode();
+    EXPECT_EQ(raw, reused.get());
+    EXPECT_EQ(0, reused->remainingBytes());
+
+    // A node still referenced elsewhere is not pooled.
+    auto shared = reused;
+    BufferNode::recycleMemBufferNode(std::move(reused));
+    EXPECT_NE(shared.get(), BufferNode::newMemBufferNode().get());
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,88 @@
+#include <xiaoNet/net/TcpServer.h>
+#include <xiaoNet/net/TcpClient.h>
+#include <gtest/gtest.h>
+#include <string>
+
+using namespace xiaoNet;
+
+namespace
+{
+    // Sends bulk data and a control message from the server and returns what
+    // the client received once the server closed the connection.
+    std::string receive(
+        const std::function<void(const TcpConnectionPtr &)> &sendAll)
+    {
+        EventLoop loop;
+        TcpServer server(&loop, InetAddress("127.0.0.1", 0), "server");
+        server.setConnectionCallback(
+            [&sendAll](const TcpConnectionPtr &conn)
+            {
+                if (!conn->connected())
+                    return;
+                sendAll(conn);
+                conn->shutdown();
+            });
+        server.start();
+        auto client =
+            std::make_shared<TcpClient>(&loop, server.address(), "client");
+        std::string received;
+        client->setMessageCallback(
+            [&received](const TcpConnectionPtr &, MsgBuffer *buffer)
+            {
+                received.append(buffer->peek(), buffer->readableBytes());
+                buffer->retrieveAll();
+            });
+        client->setConnectionCallback(
+            [&loop](const TcpConnectionPtr &conn)
+            {
+                if (!conn->connected())
+                    loop.quit();
+            });
+        client->connect();
+        loop.runAfter(10, [&loop]() { loop.quit(); });
+        loop.loop();
+        return received;
+    }
+}  // namespace
+
+TEST(ControlMessage, NotInsideScatterGatherSend)
+{
+    const std::string bulk(15 * 1024, 'a');
+    const std::string header(2 * 1024, 'h');
+    const std::string body(30 * 1024, 'b');
+    auto received = receive(
+        [&](const TcpConnectionPtr &conn)
+        {
+            // Queue the data without sending it, so that the 15KB node is
+            // the front node when the control message is sent.
+            conn->setAutoBatch(true);
+            conn->send(bulk);
+            ConstBuffer buffers[] = {{header.data(), header.size()},
+                                     {body.data(), body.size()}};
+            conn->send(buffers, 2);
+            conn->sendControl("CONTROL");
+        });
+    ASSERT_EQ(bulk.size() + header.size() + body.size() + 7, received.size());
+    EXPECT_EQ(bulk + header + body + "CONTROL", received);
+}
+
+TEST(ControlMessage, NotMergedWithLaterSends)
+{
+    const std::string bulk(64 * 1024, 'a');
+    auto received = receive(
+        [&](const TcpConnectionPtr &conn)
+        {
+            conn->setAutoBatch(true);
+            conn->send(bulk);
+            conn->sendControl("C1");
+            conn->send("b");
+            conn->sendControl("C2");
+        });
+    EXPECT_EQ(bulk + "C1C2b", received);
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
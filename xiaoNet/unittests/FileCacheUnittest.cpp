@@ -0,0 +1,84 @@
+#include <xiaoNet/net/FileCache.h>
+#include <gtest/gtest.h>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+
+using namespace xiaoNet;
+
+namespace
+{
+    std::string writeFile(const std::string &name, const std::string &content)
+    {
+        auto path = "/tmp/xiaonet_file_cache_" + name;
+        std::ofstream(path, std::ios::binary | std::ios::trunc) << content;
+        return path;
+    }
+}  // namespace
+
+TEST(FileCache, SharedOpenFile)
+{
+    auto &cache = FileCache::instance();
+    cache.clear();
+    cache.setRevalidateInterval(std::chrono::milliseconds(60000));
+    auto path = writeFile("a", "hello");
+    auto file1 = cache.open(path.c_str());
+    auto file2 = cache.open(path.c_str());
+    ASSERT_TRUE(file1);
+    EXPECT_EQ(file1, file2);
+    EXPECT_EQ(5, file1->size());
+    EXPECT_EQ(1, cache.size());
+    char buf[5];
+    EXPECT_EQ(5, pread(file1->fd(), buf, sizeof(buf), 0));
+    EXPECT_EQ("hello", std::string(buf, 5));
+    ::unlink(path.c_str());
+}
+
+TEST(FileCache, Revalidate)
+{
+    auto &cache = FileCache::instance();
+    cache.clear();
+    cache.setRevalidateInterval(std::chrono::milliseconds(0));
+    auto path = writeFile("b", "hello");
+    auto file1 = cache.open(path.c_str());
+    ASSERT_TRUE(file1);
+    EXPECT_EQ(file1, cache.open(path.c_str()));
+    writeFile("b", "hello world");
+    auto file2 = cache.open(path.c_str());
+    ASSERT_TRUE(file2);
+    EXPECT_NE(file1, file2);
+    EXPECT_EQ(11, file2->size());
+    // the old file stays usable by its users
+    EXPECT_GE(file1->fd(), 0);
+    ::unlink(path.c_str());
+    EXPECT_FALSE(cache.open(path.c_str()));
+    EXPECT_EQ(0, cache.size());
+}
+
+TEST(FileCache, Capacity)
+{
+    auto &cache = FileCache::instance();
+    cache.clear();
+    cache.setCapacity(2);
+    auto a = writeFile("c1", "1");
+    auto b = writeFile("c2", "2");
+    auto c = writeFile("c3", "3");
+    EXPECT_TRUE(cache.open(a.c_str()));
+    EXPECT_TRUE(cache.open(b.c_str()));
+    EXPECT_TRUE(cache.open(c.c_str()));
+    EXPECT_EQ(2, cache.size());
+    cache.setCapacity(0);
+    EXPECT_EQ(0, cache.size());
+    EXPECT_TRUE(cache.open(a.c_str()));
+    EXPECT_EQ(0, cache.size());
+    cache.setCapacity(1024);
+    ::unlink(a.c_str());
+    ::unlink(b.c_str());
+    ::unlink(c.c_str());
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
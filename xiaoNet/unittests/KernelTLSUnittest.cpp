@@ -0,0 +1,142 @@
+#include <xiaoNet/net/inner/KernelTLS.h>
+#include <gtest/gtest.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/sendfile.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <linux/tls.h>
+#include <unistd.h>
+#include <stdlib.h>
+
+using namespace xiaoNet;
+
+namespace
+{
+    // A connected pair of TCP sockets on the loopback interface.
+    struct LoopbackPair
+    {
+        LoopbackPair()
+        {
+            int listenFd = ::socket(AF_INET, SOCK_STREAM, 0);
+            struct sockaddr_in addr;
+            memset(&addr, 0, sizeof(addr));
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            socklen_t len = sizeof(addr);
+            ::bind(listenFd, (struct sockaddr *)&addr, len);
+            ::listen(listenFd, 1);
+            ::getsockname(listenFd, (struct sockaddr *)&addr, &len);
+            client = ::socket(AF_INET, SOCK_STREAM, 0);
+            ::connect(client, (struct sockaddr *)&addr, len);
+            server = ::accept(listenFd, nullptr, nullptr);
+            ::close(listenFd);
+        }
+        ~LoopbackPair()
+        {
+            ::close(client);
+            ::close(server);
+        }
+        int client{-1};
+        int server{-1};
+    };
+
+    KernelTLSKeys testKeys()
+    {
+        KernelTLSKeys keys;
+        keys.version = TLS_1_3_VERSION;
+        keys.cipher = TLS_CIPHER_AES_GCM_128;
+        keys.key = std::string(TLS_CIPHER_AES_GCM_128_KEY_SIZE, '\x11');
+        keys.iv = std::string(TLS_CIPHER_AES_GCM_128_IV_SIZE, '\x22');
+        keys.salt = std::string(TLS_CIPHER_AES_GCM_128_SALT_SIZE, '\x33');
+        keys.recordSequence =
+            std::string(TLS_CIPHER_AES_GCM_128_REC_SEQ_SIZE, '\0');
+        return keys;
+    }
+
+    std::string readAll(int fd, size_t length)
+    {
+        std::string data;
+        char buf[4096];
+        while (data.size() < length)
+        {
+            auto n = ::read(fd, buf, sizeof(buf));
+            if (n <= 0)
+                break;
+            data.append(buf, n);
+        }
+        return data;
+    }
+
+    // Set up kernel TLS from client to server, return false if the kernel
+    // does not support it.
+    bool setUpKernelTLS(const LoopbackPair &pair)
+    {
+        if (!KernelTLS::enable(pair.client) || !KernelTLS::enable(pair.server))
+            return false;
+        auto keys = testKeys();
+        return KernelTLS::setKeys(pair.client, true, keys) &&
+               KernelTLS::setKeys(pair.server, false, keys);
+    }
+}  // namespace
+
+TEST(KernelTLS, WriteAndRead)
+{
+    LoopbackPair pair;
+    if (!setUpKernelTLS(pair))
+        GTEST_SKIP() << "kernel TLS is not supported";
+    std::string msg = "hello kernel TLS";
+    ASSERT_EQ((ssize_t)msg.size(), ::write(pair.client, msg.data(), msg.size()));
+    EXPECT_EQ(msg, readAll(pair.server, msg.size()));
+}
+
+TEST(KernelTLS, Sendfile)
+{
+    LoopbackPair pair;
+    if (!setUpKernelTLS(pair))
+        GTEST_SKIP() << "kernel TLS is not supported";
+    char path[] = "/tmp/xiaonet_ktls_XXXXXX";
+    int fd = ::mkstemp(path);
+    ASSERT_GE(fd, 0);
+    ::unlink(path);
+    std::string content(100000, 'x');
+    for (size_t i = 0; i < content.size(); i += 13)
+        content[i] = static_cast<char>('a' + i % 26);
+    ASSERT_EQ((ssize_t)content.size(),
+              ::write(fd, content.data(), content.size()));
+    off_t offset = 0;
+    size_t sent = 0;
+    while (sent < content.size())
+    {
+        auto n = ::sendfile(pair.client, fd, &offset, content.size() - sent);
+        ASSERT_GT(n, 0);
+        sent += n;
+    }
+    ::close(fd);
+    EXPECT_EQ(content, readAll(pair.server, content.size()));
+}
+
+TEST(KernelTLS, AlertRecord)
+{
+    LoopbackPair pair;
+    if (!setUpKernelTLS(pair))
+        GTEST_SKIP() << "kernel TLS is not supported";
+    const unsigned char alert[2] = {1, 0};
+    ASSERT_EQ(2,
+              KernelTLS::sendRecord(pair.client,
+                                    KernelTLS::kRecordAlert,
+                                    alert,
+                                    sizeof(alert)));
+    char buf[64];
+    // read() refuses records which are not application data
+    EXPECT_LT(::read(pair.server, buf, sizeof(buf)), 0);
+    uint8_t type = 0;
+    EXPECT_EQ(2, KernelTLS::recvRecord(pair.server, type, buf, sizeof(buf)));
+    EXPECT_EQ(KernelTLS::kRecordAlert, type);
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
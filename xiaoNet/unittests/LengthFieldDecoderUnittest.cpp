@@ -0,0 +1,65 @@
+#include <xiaoNet/net/LengthFieldDecoder.h>
+#include <gtest/gtest.h>
+#include <string>
+
+using namespace xiaoNet;
+
+TEST(LengthFieldDecoder, DefaultLayout)
+{
+    LengthFieldDecoder decoder;
+    MsgBuffer buf;
+    FrameView frame;
+    size_t frameLength = 0;
+    EXPECT_EQ(FrameStatus::kNeedMore, decoder.decode(buf, frame, frameLength));
+    buf.appendInt32(5);
+    buf.append("hel");
+    EXPECT_EQ(FrameStatus::kNeedMore, decoder.decode(buf, frame, frameLength));
+    buf.append("lo");
+    EXPECT_EQ(FrameStatus::kComplete, decoder.decode(buf, frame, frameLength));
+    EXPECT_EQ(9, frameLength);
+    EXPECT_EQ(std::string("\0\0\0\5hello", 9),
+              std::string(frame.data, frame.length));
+    // the buffer is not modified by the decoder
+    EXPECT_EQ(9, buf.readableBytes());
+}
+
+TEST(LengthFieldDecoder, OffsetAdjustmentAndStrip)
+{
+    // | magic(2) | length(2, includes the whole frame) | type(1) | payload |
+    LengthFieldDecoder decoder(2, 2, -4, 5);
+    MsgBuffer buf;
+    buf.appendInt16(0xcafe);
+    buf.appendInt16(2 + 2 + 1 + 3);
+    buf.appendInt8(7);
+    buf.append("abc");
+    buf.appendInt16(0xcafe);
+    FrameView frame;
+    size_t frameLength = 0;
+    EXPECT_EQ(FrameStatus::kComplete, decoder.decode(buf, frame, frameLength));
+    EXPECT_EQ(8, frameLength);
+    EXPECT_EQ("abc", std::string(frame.data, frame.length));
+    buf.retrieve(frameLength);
+    EXPECT_EQ(FrameStatus::kNeedMore, decoder.decode(buf, frame, frameLength));
+}
+
+TEST(LengthFieldDecoder, InvalidFrames)
+{
+    LengthFieldDecoder decoder(0, 1, 0, 0, 16);
+    MsgBuffer buf;
+    FrameView frame;
+    size_t frameLength = 0;
+    buf.appendInt8(200);
+    EXPECT_EQ(FrameStatus::kTooLarge, decoder.decode(buf, frame, frameLength));
+
+    LengthFieldDecoder negative(0, 1, -8);
+    MsgBuffer buf2;
+    buf2.appendInt8(4);
+    EXPECT_EQ(FrameStatus::kMalformed,
+              negative.decode(buf2, frame, frameLength));
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
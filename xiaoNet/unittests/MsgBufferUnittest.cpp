@@ -73,6 +73,171 @@ TEST(MsgBuffer, MoveAssignmentOperator)
     EXPECT_EQ(writable, buffnew.writableBytes());
 }
 
+TEST(MsgBuffer, FindCRLF)
+{
+    MsgBuffer buf;
+    EXPECT_EQ(nullptr, buf.findCRLF());
+    buf.append("GET / HTTP/1.1");
+    EXPECT_EQ(nullptr, buf.findCRLF());
+    buf.append("\r\nHost: example.com\r\n");
+    EXPECT_EQ(buf.peek() + 14, buf.findCRLF());
+
+    // every position around the 16 and 32 bytes boundaries of the vector
+    // kernels
+    for (size_t pos = 0; pos < 100; ++pos)
+    {
+        MsgBuffer b;
+        b.append(std::string(pos, 'a') + "\r\n" + std::string(50, 'b'));
+        EXPECT_EQ(b.peek() + pos, b.findCRLF());
+        MsgBuffer lone;
+        lone.append(std::string(pos, '\r') + "x\n");
+        EXPECT_EQ(nullptr, lone.findCRLF());
+    }
+}
+
+TEST(MsgBuffer, ResumableFindCRLF)
+{
+    MsgBuffer buf;
+    size_t offset = 0;
+    buf.append(std::string(100, 'a') + "\r");
+    EXPECT_EQ(nullptr, buf.findCRLF(offset));
+    EXPECT_EQ(100, offset);
+    buf.append("\nbbb");
+    EXPECT_EQ(buf.peek() + 100, buf.findCRLF(offset));
+    EXPECT_EQ(100, offset);
+
+    MsgBuffer header;
+    offset = 0;
+    header.append("HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r");
+    EXPECT_EQ(nullptr, header.findDoubleCRLF(offset));
+    EXPECT_EQ(header.readableBytes() - 3, offset);
+    header.append("\n");
+    EXPECT_EQ(header.peek() + header.readableBytes() - 4,
+              header.findDoubleCRLF(offset));
+}
+
+TEST(MsgBuffer, FindChar)
+{
+    MsgBuffer buf;
+    buf.append(std::string(70, 'a') + ":" + std::string(70, 'b') + ":");
+    size_t offset = 0;
+    EXPECT_EQ(buf.peek() + 70, buf.findChar(':', offset));
+    offset += 1;
+    EXPECT_EQ(buf.peek() + 141, buf.findChar(':', offset));
+    offset += 1;
+    EXPECT_EQ(nullptr, buf.findChar(':', offset));
+    EXPECT_EQ(buf.readableBytes(), offset);
+    EXPECT_EQ(nullptr, buf.findChar('c'));
+}
+
+TEST(MsgBuffer, FindAnyOf)
+{
+    for (size_t pos = 0; pos < 80; ++pos)
+    {
+        MsgBuffer buf;
+        buf.append(std::string(pos, 'x') + "+" + std::string(40, 'y'));
+        EXPECT_EQ(buf.peek() + pos, buf.findAnyOf("\r\n+-", 4));
+        // more characters than the vector kernels handle
+        EXPECT_EQ(buf.peek() + pos,
+                  buf.findAnyOf("abcdefghijklmnopqrstuvw+", 24));
+        EXPECT_EQ(nullptr, buf.findAnyOf("\r\n-", 3));
+    }
+    MsgBuffer resp;
+    resp.append("$5\r\nhello\r\n");
+    size_t offset = 1;
+    EXPECT_EQ(resp.peek() + 2, resp.findAnyOf("\r\n", 2, offset));
+    EXPECT_EQ(2, offset);
+}
+
+TEST(MsgBuffer, VarInt)
+{
+    MsgBuffer buf;
+    const uint64_t values[] = {
+        0, 1, 127, 128, 300, 16383, 16384, 0xffffffff, 0xffffffffffffffffULL};
+    for (auto v : values)
+        buf.appendVarUInt(v);
+    buf.appendVarInt(-1);
+    buf.appendVarInt(-64);
+    buf.appendVarInt(INT64_MIN);
+    EXPECT_EQ(1 + 1 + 1 + 2 + 2 + 2 + 3 + 5 + 10 + 1 + 1 + 10,
+              buf.readableBytes());
+    for (auto v : values)
+    {
+        uint64_t r;
+        EXPECT_EQ(MsgBuffer::varUIntLength(v), buf.readVarUInt(r));
+        EXPECT_EQ(v, r);
+    }
+    int64_t s;
+    EXPECT_EQ(1, buf.readVarInt(s));
+    EXPECT_EQ(-1, s);
+    EXPECT_EQ(1, buf.readVarInt(s));
+    EXPECT_EQ(-64, s);
+    EXPECT_EQ(10, buf.readVarInt(s));
+    EXPECT_EQ(INT64_MIN, s);
+    EXPECT_EQ(0, buf.readableBytes());
+
+    uint64_t r;
+    buf.append("\x80\x80");
+    EXPECT_EQ(0, buf.peekVarUInt(r));
+    EXPECT_EQ(2, buf.readableBytes());
+    buf.retrieveAll();
+    buf.append(std::string(10, '\xff') + "\x01");
+    EXPECT_EQ(-1, buf.readVarUInt(r));
+    EXPECT_EQ(11, buf.readableBytes());
+}
+
+TEST(MsgBuffer, TryReadFrame)
+{
+    MsgBuffer buf;
+    FrameView frame;
+    EXPECT_EQ(FrameStatus::kNeedMore, buf.tryReadFrame(4, 1024, frame));
+    buf.appendInt32(5);
+    buf.append("hel");
+    EXPECT_EQ(FrameStatus::kNeedMore, buf.tryReadFrame(4, 1024, frame));
+    EXPECT_EQ(7, buf.readableBytes());
+    buf.append("lo");
+    buf.appendInt16(3);
+    buf.append("abc");
+    EXPECT_EQ(FrameStatus::kComplete, buf.tryReadFrame(4, 1024, frame));
+    EXPECT_EQ("hello", std::string(frame.data, frame.length));
+    EXPECT_EQ(FrameStatus::kTooLarge, buf.tryReadFrame(2, 2, frame));
+    EXPECT_EQ(FrameStatus::kComplete, buf.tryReadFrame(2, 1024, frame));
+    EXPECT_EQ("abc", std::string(frame.data, frame.length));
+    EXPECT_EQ(0, buf.readableBytes());
+
+    buf.appendVarUInt(300);
+    buf.append(std::string(300, 'v'));
+    EXPECT_EQ(FrameStatus::kComplete, buf.tryReadFrame(0, 1024, frame));
+    EXPECT_EQ(std::string(300, 'v'), std::string(frame.data, frame.length));
+    EXPECT_EQ(FrameStatus::kMalformed, buf.tryReadFrame(3, 1024, frame));
+}
+
+TEST(MsgBuffer, BatchWriter)
+{
+    MsgBuffer buf(16);
+    {
+        MsgBuffer::BatchWriter writer(buf, 1 + 2 + 4 + 8 + 2 * kMaxVarIntLength);
+        writer.appendInt8(1);
+        writer.appendInt16(2);
+        writer.appendInt32(3);
+        writer.appendInt64(4);
+        writer.appendVarUInt(300);
+        writer.appendVarInt(-3);
+        EXPECT_EQ(0, buf.readableBytes());
+    }
+    EXPECT_EQ(1 + 2 + 4 + 8 + 2 + 1, buf.readableBytes());
+    EXPECT_EQ(1, buf.readInt8());
+    EXPECT_EQ(2, buf.readInt16());
+    EXPECT_EQ(3, buf.readInt32());
+    EXPECT_EQ(4, buf.readInt64());
+    uint64_t u;
+    EXPECT_EQ(2, buf.readVarUInt(u));
+    EXPECT_EQ(300, u);
+    int64_t i;
+    EXPECT_EQ(1, buf.readVarInt(i));
+    EXPECT_EQ(-3, i);
+}
+
 int main(int argc, char **argv)
 {
     testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,59 @@
+#include <xiaoNet/net/inner/Socket.h>
+#include <xiaoNet/net/SocketPolicy.h>
+#include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+using namespace xiaoNet;
+
+namespace
+{
+    int getIntOption(int fd, int level, int option)
+    {
+        int optval = -1;
+        socklen_t len = sizeof optval;
+        if (::getsockopt(fd, level, option, &optval, &len) < 0)
+            return -1;
+        return optval;
+    }
+}  // namespace
+
+TEST(SocketPolicy, UnsetByDefault)
+{
+    SocketPolicy policy;
+    EXPECT_LT(policy.getBusyPoll(), 0);
+    EXPECT_LT(policy.getIncomingCpu(), 0);
+    EXPECT_LT(policy.getRecvBufferSize(), 0);
+    EXPECT_LT(policy.getSendBufferSize(), 0);
+    EXPECT_LT(policy.getQuickAck(), 0);
+    EXPECT_LT(policy.getUserTimeout(), 0);
+}
+
+TEST(SocketPolicy, Apply)
+{
+    Socket sock(::socket(AF_INET, SOCK_STREAM, 0));
+    ASSERT_GE(sock.fd(), 0);
+    SocketPolicy policy;
+    policy.setRecvBufferSize(32 * 1024)
+        .setSendBufferSize(32 * 1024)
+        .setUserTimeout(5000)
+        .setQuickAck(true)
+        .setIncomingCpu(0);
+    sock.applyPolicy(policy);
+    // The kernel doubles the buffer sizes.
+    EXPECT_EQ(64 * 1024, getIntOption(sock.fd(), SOL_SOCKET, SO_RCVBUF));
+    EXPECT_EQ(64 * 1024, getIntOption(sock.fd(), SOL_SOCKET, SO_SNDBUF));
+    EXPECT_EQ(5000, getIntOption(sock.fd(), IPPROTO_TCP, TCP_USER_TIMEOUT));
+    EXPECT_EQ(1, getIntOption(sock.fd(), IPPROTO_TCP, TCP_QUICKACK));
+    EXPECT_EQ(0, getIntOption(sock.fd(), SOL_SOCKET, SO_INCOMING_CPU));
+
+    EXPECT_TRUE(sock.setUserTimeout(0));
+    EXPECT_EQ(0, getIntOption(sock.fd(), IPPROTO_TCP, TCP_USER_TIMEOUT));
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -16,6 +16,12 @@
 #else
 #endif
 
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__) && \
+    (defined(__GNUC__) || defined(__clang__))
+#define XIAONET_SEARCH_SSE2 1
+#include <x86intrin.h>
+#endif
+
 using namespace xiaoNet;
 using namespace xiaoLog;
 namespace xiaoNet
@@ -23,6 +29,210 @@ namespace xiaoNet
     static constexpr size_t kBufferOffset{8};
 }
 
+namespace
+{
+    // The search kernels below return 'end' when nothing is found.
+    const char *findSequenceScalar(const char *p,
+                                   const char *end,
+                                   const char *seq,
+                                   size_t n)
+    {
+        while (static_cast<size_t>(end - p) >= n)
+        {
+            p = static_cast<const char *>(memchr(p, seq[0], end - p - n + 1));
+            if (p == nullptr)
+                return end;
+            if (memcmp(p + 1, seq + 1, n - 1) == 0)
+                return p;
+            ++p;
+        }
+        return end;
+    }
+
+    const char *findAnyOfScalar(const char *p,
+                                const char *end,
+                                const char *chars,
+                                size_t n)
+    {
+        bool table[256] = {false};
+        for (size_t i = 0; i < n; ++i)
+            table[static_cast<unsigned char>(chars[i])] = true;
+        for (; p < end; ++p)
+        {
+            if (table[static_cast<unsigned char>(*p)])
+                return p;
+        }
+        return end;
+    }
+
+#ifdef XIAONET_SEARCH_SSE2
+    // Sets with more characters than this are searched with a lookup table.
+    constexpr size_t kMaxSimdSetSize{16};
+
+    // Candidates are the positions where both the first and the last byte of
+    // the sequence match, they are verified with memcmp. For CRLF the filter is
+    // exact, so no verification is needed.
+    const char *findSequenceSse2(const char *p,
+                                 const char *end,
+                                 const char *seq,
+                                 size_t n)
+    {
+        const __m128i first = _mm_set1_epi8(seq[0]);
+        const __m128i last = _mm_set1_epi8(seq[n - 1]);
+        while (static_cast<size_t>(end - p) >= 16 + n - 1)
+        {
+            __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+            __m128i b1 =
+                _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + n - 1));
+            unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(
+                _mm_and_si128(_mm_cmpeq_epi8(b0, first),
+                              _mm_cmpeq_epi8(b1, last))));
+            while (mask)
+            {
+                int bit = __builtin_ctz(mask);
+                if (n <= 2 || memcmp(p + bit + 1, seq + 1, n - 2) == 0)
+                    return p + bit;
+                mask &= mask - 1;
+            }
+            p += 16;
+        }
+        return findSequenceScalar(p, end, seq, n);
+    }
+
+    const char *findAnyOfSse2(const char *p,
+                              const char *end,
+                              const char *chars,
+                              size_t n)
+    {
+        if (n > kMaxSimdSetSize)
+            return findAnyOfScalar(p, end, chars, n);
+        __m128i set[kMaxSimdSetSize];
+        for (size_t i = 0; i < n; ++i)
+            set[i] = _mm_set1_epi8(chars[i]);
+        while (end - p >= 16)
+        {
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+            __m128i hit = _mm_cmpeq_epi8(b, set[0]);
+            for (size_t i = 1; i < n; ++i)
+                hit = _mm_or_si128(hit, _mm_cmpeq_epi8(b, set[i]));
+            unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(hit));
+            if (mask)
+                return p + __builtin_ctz(mask);
+            p += 16;
+        }
+        return findAnyOfScalar(p, end, chars, n);
+    }
+
+    __attribute__((target("avx2"))) const char *findSequenceAvx2(
+        const char *p,
+        const char *end,
+        const char *seq,
+        size_t n)
+    {
+        const __m256i first = _mm256_set1_epi8(seq[0]);
+        const __m256i last = _mm256_set1_epi8(seq[n - 1]);
+        while (static_cast<size_t>(end - p) >= 32 + n - 1)
+        {
+            __m256i b0 =
+                _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+            __m256i b1 = _mm256_loadu_si256(
+                reinterpret_cast<const __m256i *>(p + n - 1));
+            unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(
+                _mm256_and_si256(_mm256_cmpeq_epi8(b0, first),
+                                 _mm256_cmpeq_epi8(b1, last))));
+            while (mask)
+            {
+                int bit = __builtin_ctz(mask);
+                if (n <= 2 || memcmp(p + bit + 1, seq + 1, n - 2) == 0)
+                    return p + bit;
+                mask &= mask - 1;
+            }
+            p += 32;
+        }
+        return findSequenceSse2(p, end, seq, n);
+    }
+
+    __attribute__((target("avx2"))) const char *findAnyOfAvx2(
+        const char *p,
+        const char *end,
+        const char *chars,
+        size_t n)
+    {
+        if (n > kMaxSimdSetSize)
+            return findAnyOfScalar(p, end, chars, n);
+        __m256i set[kMaxSimdSetSize];
+        for (size_t i = 0; i < n; ++i)
+            set[i] = _mm256_set1_epi8(chars[i]);
+        while (end - p >= 32)
+        {
+            __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+            __m256i hit = _mm256_cmpeq_epi8(b, set[0]);
+            for (size_t i = 1; i < n; ++i)
+                hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(b, set[i]));
+            unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(hit));
+            if (mask)
+                return p + __builtin_ctz(mask);
+            p += 32;
+        }
+        return findAnyOfSse2(p, end, chars, n);
+    }
+#endif
+
+    using FindSequenceFunc = const char *(*)(const char *,
+                                             const char *,
+                                             const char *,
+                                             size_t);
+    using FindAnyOfFunc = const char *(*)(const char *,
+                                          const char *,
+                                          const char *,
+                                          size_t);
+
+    struct SearchKernels
+    {
+        FindSequenceFunc findSequence{findSequenceScalar};
+        FindAnyOfFunc findAnyOf{findAnyOfScalar};
+        SearchKernels()
+        {
+#ifdef XIAONET_SEARCH_SSE2
+            if (__builtin_cpu_supports("avx2"))
+            {
+                findSequence = findSequenceAvx2;
+                findAnyOf = findAnyOfAvx2;
+            }
+            else
+            {
+                findSequence = findSequenceSse2;
+                findAnyOf = findAnyOfSse2;
+            }
+#endif
+        }
+    };
+
+    const SearchKernels &searchKernels()
+    {
+        static const SearchKernels kernels;
+        return kernels;
+    }
+
+    // Turn the result of a kernel into the result of a resumable search.
+    const char *searchResult(const char *begin,
+                             const char *end,
+                             const char *found,
+                             size_t n,
+                             size_t &offset)
+    {
+        if (found != end)
+        {
+            offset = found - begin;
+            return found;
+        }
+        size_t readable = end - begin;
+        if (readable >= n - 1 && readable - (n - 1) > offset)
+            offset = readable - (n - 1);
+        return nullptr;
+    }
+}
+
 MsgBuffer::MsgBuffer(size_t len)
     : head_(kBufferOffset), initCap_(len), buffer_(len + head_), tail_(head_)
 {
@@ -107,6 +317,7 @@ uint16_t MsgBuffer::peekInt16() const
 {
     assert(readableBytes() >= 2);
     uint16_t rs = *(static_cast<const uint16_t *>((void *)peek()));
+    return ntohs(rs);
 }
 uint32_t MsgBuffer::peekInt32() const
 {
@@ -121,6 +332,37 @@ uint64_t MsgBuffer::peekInt64() const
     return ntoh64(rll);
 }
 
+ssize_t MsgBuffer::peekVarUInt(uint64_t &value) const
+{
+    auto p = reinterpret_cast<const unsigned char *>(peek());
+    size_t readable = readableBytes();
+    uint64_t result = 0;
+    for (size_t i = 0; i < kMaxVarIntLength; ++i)
+    {
+        if (i >= readable)
+            return 0;
+        uint8_t b = p[i];
+        // the 10th byte can only hold the highest bit of a 64 bits value
+        if (i == kMaxVarIntLength - 1 && b > 1)
+            return -1;
+        result |= static_cast<uint64_t>(b & 0x7f) << (7 * i);
+        if ((b & 0x80) == 0)
+        {
+            value = result;
+            return static_cast<ssize_t>(i + 1);
+        }
+    }
+    return -1;
+}
+ssize_t MsgBuffer::peekVarInt(int64_t &value) const
+{
+    uint64_t v;
+    auto n = peekVarUInt(v);
+    if (n > 0)
+        value = zigzagDecode(v);
+    return n;
+}
+
 void MsgBuffer::retrieve(size_t len)
 {
     if (len >= readableBytes())
@@ -198,6 +440,72 @@ uint64_t MsgBuffer::readInt64()
     return ret;
 }
 
+ssize_t MsgBuffer::readVarUInt(uint64_t &value)
+{
+    auto n = peekVarUInt(value);
+    if (n > 0)
+        retrieve(n);
+    return n;
+}
+ssize_t MsgBuffer::readVarInt(int64_t &value)
+{
+    auto n = peekVarInt(value);
+    if (n > 0)
+        retrieve(n);
+    return n;
+}
+
+FrameStatus MsgBuffer::tryReadFrame(size_t prefixWidth,
+                                    size_t maxLen,
+                                    FrameView &frame)
+{
+    uint64_t len;
+    size_t prefixLen = prefixWidth;
+    if (prefixWidth != 0 && prefixWidth != 1 && prefixWidth != 2 &&
+        prefixWidth != 4 && prefixWidth != 8)
+    {
+        LOG_ERROR << "invalid frame prefix width: " << prefixWidth;
+        return FrameStatus::kMalformed;
+    }
+    if (readableBytes() < prefixWidth)
+        return FrameStatus::kNeedMore;
+    switch (prefixWidth)
+    {
+        case 0:
+        {
+            auto n = peekVarUInt(len);
+            if (n == 0)
+                return FrameStatus::kNeedMore;
+            if (n < 0)
+                return FrameStatus::kMalformed;
+            prefixLen = static_cast<size_t>(n);
+            break;
+        }
+        case 1:
+            len = peekInt8();
+            break;
+        case 2:
+            len = peekInt16();
+            break;
+        case 4:
+            len = peekInt32();
+            break;
+        default:
+            len = peekInt64();
+            break;
+    }
+    if (len > maxLen)
+        return FrameStatus::kTooLarge;
+    if (readableBytes() - prefixLen < len)
+        return FrameStatus::kNeedMore;
+    frame.data = peek() + prefixLen;
+    frame.length = static_cast<size_t>(len);
+    // Don't call retrieve() here, it may shrink the buffer when all the data
+    // is consumed, and the frame would point to the released memory.
+    head_ += prefixLen + frame.length;
+    return FrameStatus::kComplete;
+}
+
 void MsgBuffer::addInFront(const char *buf, size_t len)
 {
     if (head_ >= len)
@@ -222,4 +530,44 @@ void MsgBuffer::addInFront(const char *buf, size_t len)
     newBuf.append(buf, len);
     newBuf.append(*this);
     swap(newBuf);
-}
\ No newline at end of file
+}
+const char *MsgBuffer::findSequence(const char *seq,
+                                   size_t n,
+                                   size_t &offset) const
+{
+    assert(n > 0);
+    const char *begin = peek();
+    const char *end = beginWrite();
+    if (offset >= readableBytes())
+        return nullptr;
+    const char *found =
+        searchKernels().findSequence(begin + offset, end, seq, n);
+    return searchResult(begin, end, found, n, offset);
+}
+
+const char *MsgBuffer::findChar(char c, size_t &offset) const
+{
+    const char *begin = peek();
+    const char *end = beginWrite();
+    if (offset >= readableBytes())
+        return nullptr;
+    // memchr is vectorized by the C library
+    auto found = static_cast<const char *>(
+        memchr(begin + offset, c, readableBytes() - offset));
+    return searchResult(begin, end, found ? found : end, 1, offset);
+}
+
+const char *MsgBuffer::findAnyOf(const char *chars,
+                                 size_t n,
+                                 size_t &offset) const
+{
+    const char *begin = peek();
+    const char *end = beginWrite();
+    if (n == 0 || offset >= readableBytes())
+        return nullptr;
+    if (n == 1)
+        return findChar(chars[0], offset);
+    const char *found =
+        searchKernels().findAnyOf(begin + offset, end, chars, n);
+    return searchResult(begin, end, found, 1, offset);
+}
@@ -23,6 +23,31 @@ namespace xiaoNet
 {
     static constexpr size_t kBufferDefaultLength{2048};
     static constexpr char CRLF[]{"\r\n"};
+    static constexpr char kDoubleCRLF[]{"\r\n\r\n"};
+    static constexpr size_t kMaxVarIntLength{10};
+
+    /**
+     * @brief A view of a frame in a MsgBuffer. The view is valid until the
+     * buffer is modified again.
+     *
+     */
+    struct FrameView
+    {
+        const char *data{nullptr};
+        size_t length{0};
+    };
+
+    /**
+     * @brief The result of the MsgBuffer::tryReadFrame() method.
+     *
+     */
+    enum class FrameStatus
+    {
+        kComplete,
+        kNeedMore,
+        kTooLarge,
+        kMalformed
+    };
 
     /**
      * @brief This class represents a memory buffer used for sending and
@@ -95,6 +120,25 @@ namespace xiaoNet
          */
         uint64_t peekInt64() const;
 
+        /**
+         * @brief Get a LEB128 (protobuf style) encoded unsigned integer from the
+         * buffer.
+         *
+         * @param value The decoded value, only set on success.
+         * @return ssize_t The number of bytes the integer occupies, 0 if more
+         * data is needed, -1 if the encoding is invalid (longer than 10 bytes or
+         * larger than 64 bits).
+         */
+        ssize_t peekVarUInt(uint64_t &value) const;
+
+        /**
+         * @brief Get a zigzag and LEB128 encoded signed integer from the buffer.
+         *
+         * @param value
+         * @return ssize_t Refer to the peekVarUInt() method.
+         */
+        ssize_t peekVarInt(int64_t &value) const;
+
         /**
          * @brief Get and remove some bytes from the buffer.
          *
@@ -131,6 +175,41 @@ namespace xiaoNet
          */
         uint64_t readInt64();
 
+        /**
+         * @brief Get and remove a LEB128 encoded unsigned integer from the buffer.
+         *
+         * @param value
+         * @return ssize_t Refer to the peekVarUInt() method. Nothing is removed
+         * unless the return value is positive.
+         */
+        ssize_t readVarUInt(uint64_t &value);
+
+        /**
+         * @brief Get and remove a zigzag and LEB128 encoded signed integer from
+         * the buffer.
+         *
+         * @param value
+         * @return ssize_t Refer to the readVarUInt() method.
+         */
+        ssize_t readVarInt(int64_t &value);
+
+        /**
+         * @brief Get and remove a length prefixed frame from the buffer without
+         * copying it.
+         *
+         * @param prefixWidth The width of the big-endian length prefix, it must
+         * be 1, 2, 4 or 8. 0 means that the length is a LEB128 varint.
+         * @param maxLen The maximum length of the frame payload.
+         * @param frame The payload of the frame (the prefix is not included),
+         * only set when kComplete is returned. It points into this buffer and is
+         * valid until the buffer is modified again.
+         * @return FrameStatus Nothing is removed from the buffer unless kComplete
+         * is returned.
+         */
+        FrameStatus tryReadFrame(size_t prefixWidth,
+                                 size_t maxLen,
+                                 FrameView &frame);
+
         /**
          * @brief swap the buffer with another.
          *
@@ -158,6 +237,17 @@ namespace xiaoNet
             return buffer_.size() - tail_;
         }
 
+        /**
+         * @brief Return the number of bytes allocated by the buffer. It doesn't
+         * decrease when the data is retrieved.
+         *
+         * @return size_t
+         */
+        size_t capacity() const
+        {
+            return buffer_.capacity();
+        }
+
         /**
          * @brief Append new data to the buffer.
          *
@@ -208,6 +298,138 @@ namespace xiaoNet
          */
         void appendInt64(const uint64_t l);
 
+        /**
+         * @brief Append a LEB128 encoded unsigned integer to the end of the
+         * buffer.
+         *
+         * @param v
+         */
+        void appendVarUInt(const uint64_t v)
+        {
+            ensureWritableBytes(kMaxVarIntLength);
+            tail_ += encodeVarUInt(beginWrite(), v);
+        }
+
+        /**
+         * @brief Append a zigzag and LEB128 encoded signed integer to the end of
+         * the buffer.
+         *
+         * @param v
+         */
+        void appendVarInt(const int64_t v)
+        {
+            appendVarUInt(zigzagEncode(v));
+        }
+
+        /**
+         * @brief This class appends many small values to a buffer with only one
+         * capacity check. The space is reserved when the writer is constructed
+         * and the data becomes readable when the writer is destroyed (or when
+         * commit() is called).
+         * @code
+           {
+               MsgBuffer::BatchWriter writer(buffer, 4 + 8 + kMaxVarIntLength);
+               writer.appendInt32(id);
+               writer.appendInt64(timestamp);
+               writer.appendVarUInt(payloadLength);
+           }
+           @endcode
+         */
+        class BatchWriter : public NonCopyable
+        {
+        public:
+            /**
+             * @brief Construct a new Batch Writer object
+             *
+             * @param buffer The buffer to append to. It must not be accessed by
+             * other ways before the writer is destroyed.
+             * @param maxLen The maximum number of bytes that will be appended.
+             */
+            BatchWriter(MsgBuffer &buffer, size_t maxLen) : buffer_(buffer)
+            {
+                buffer_.ensureWritableBytes(maxLen);
+                cur_ = buffer_.beginWrite();
+#ifndef NDEBUG
+                limit_ = cur_ + maxLen;
+#endif
+            }
+            ~BatchWriter()
+            {
+                commit();
+            }
+            void append(const char *buf, size_t len)
+            {
+                assert(cur_ + len <= limit_);
+                memcpy(cur_, buf, len);
+                cur_ += len;
+            }
+            void appendInt8(const uint8_t b)
+            {
+                assert(cur_ + 1 <= limit_);
+                *cur_++ = static_cast<char>(b);
+            }
+            void appendInt16(const uint16_t s)
+            {
+                const unsigned char bytes[2] = {
+                    static_cast<unsigned char>(s >> 8),
+                    static_cast<unsigned char>(s)};
+                append(reinterpret_cast<const char *>(bytes), 2);
+            }
+            void appendInt32(const uint32_t i)
+            {
+                appendInt16(static_cast<uint16_t>(i >> 16));
+                appendInt16(static_cast<uint16_t>(i));
+            }
+            void appendInt64(const uint64_t l)
+            {
+                appendInt32(static_cast<uint32_t>(l >> 32));
+                appendInt32(static_cast<uint32_t>(l));
+            }
+            void appendVarUInt(const uint64_t v)
+            {
+                assert(cur_ + kMaxVarIntLength <= limit_ ||
+                       cur_ + varUIntLength(v) <= limit_);
+                cur_ += encodeVarUInt(cur_, v);
+            }
+            void appendVarInt(const int64_t v)
+            {
+                appendVarUInt(zigzagEncode(v));
+            }
+
+            /**
+             * @brief Make the bytes written so far readable in the buffer.
+             *
+             */
+            void commit()
+            {
+                buffer_.hasWritten(cur_ - buffer_.beginWrite());
+            }
+
+        private:
+            MsgBuffer &buffer_;
+            char *cur_;
+#ifndef NDEBUG
+            const char *limit_;
+#endif
+        };
+
+        /**
+         * @brief Return the number of bytes of the LEB128 encoding of a value.
+         *
+         * @param v
+         * @return size_t
+         */
+        static size_t varUIntLength(uint64_t v)
+        {
+            size_t n = 1;
+            while (v >= 0x80)
+            {
+                v >>= 7;
+                ++n;
+            }
+            return n;
+        }
+
         /**
          * @brief Put new data to the beginning of the buffer.
          *
@@ -284,14 +506,113 @@ namespace xiaoNet
         /**
          * @brief Find the position of the buffer where the CRLF is found.
          *
-         * @return const char*
+         * @return const char* NULL if there is no CRLF in the buffer.
          */
         const char *findCRLF() const
         {
-            const char *crlf = std::search(peek(), beginWrite(), CRLF, CRLF + 2);
-            return crlf == beginWrite() ? NULL : crlf;
+            size_t offset = 0;
+            return findCRLF(offset);
+        }
+
+        /**
+         * @brief Find the CRLF, resuming a previous search.
+         *
+         * @param offset The offset (relative to peek()) where the search starts.
+         * On success it is set to the offset of the match, otherwise it is set
+         * to the offset where the next search should resume, so that bytes
+         * which have already been scanned are not scanned again when more data
+         * arrives.
+         * @return const char* NULL if there is no CRLF after the offset.
+         * @note The offset is relative to peek(), so it must be decreased (or
+         * reset) when data is retrieved from the buffer.
+         */
+        const char *findCRLF(size_t &offset) const
+        {
+            return findSequence(CRLF, 2, offset);
+        }
+
+        /**
+         * @brief Find the position of the buffer where the "\r\n\r\n" (the end
+         * of a HTTP header) is found.
+         *
+         * @return const char* NULL if there is no double CRLF in the buffer.
+         */
+        const char *findDoubleCRLF() const
+        {
+            size_t offset = 0;
+            return findDoubleCRLF(offset);
+        }
+
+        /**
+         * @brief Find the double CRLF, resuming a previous search.
+         *
+         * @param offset Refer to the findCRLF(size_t &) method.
+         * @return const char*
+         */
+        const char *findDoubleCRLF(size_t &offset) const
+        {
+            return findSequence(kDoubleCRLF, 4, offset);
+        }
+
+        /**
+         * @brief Find the first occurrence of a character.
+         *
+         * @param c
+         * @return const char* NULL if the character is not found.
+         */
+        const char *findChar(char c) const
+        {
+            size_t offset = 0;
+            return findChar(c, offset);
+        }
+
+        /**
+         * @brief Find the first occurrence of a character, resuming a previous
+         * search.
+         *
+         * @param c
+         * @param offset Refer to the findCRLF(size_t &) method.
+         * @return const char*
+         */
+        const char *findChar(char c, size_t &offset) const;
+
+        /**
+         * @brief Find the first occurrence of any of the given characters.
+         *
+         * @param chars The set of characters to search for.
+         * @param n The number of characters in the set.
+         * @return const char* NULL if none of the characters is found.
+         */
+        const char *findAnyOf(const char *chars, size_t n) const
+        {
+            size_t offset = 0;
+            return findAnyOf(chars, n, offset);
         }
 
+        /**
+         * @brief Find the first occurrence of any of the given characters,
+         * resuming a previous search.
+         *
+         * @param chars
+         * @param n
+         * @param offset Refer to the findCRLF(size_t &) method.
+         * @return const char*
+         */
+        const char *findAnyOf(const char *chars, size_t n, size_t &offset) const;
+
+        /**
+         * @brief Find the first occurrence of a byte sequence, resuming a previous
+         * search.
+         *
+         * @param seq The sequence to search for.
+         * @param n The length of the sequence, it must be greater than 0.
+         * @param offset Refer to the findCRLF(size_t &) method. When the sequence
+         * is not found, the last n - 1 bytes are searched again next time
+         * because they may be the beginning of a match.
+         * @return const char*
+         */
+        const char *findSequence(const char *seq, size_t n, size_t &offset) const;
+
         /**
          * @brief Make sure the buffer has enough spaces to write data.
          *
@@ -341,6 +662,26 @@ namespace xiaoNet
         }
 
     private:
+        static size_t encodeVarUInt(char *p, uint64_t v)
+        {
+            size_t n = 0;
+            while (v >= 0x80)
+            {
+                p[n++] = static_cast<char>((v & 0x7f) | 0x80);
+                v >>= 7;
+            }
+            p[n++] = static_cast<char>(v);
+            return n;
+        }
+        static uint64_t zigzagEncode(int64_t v)
+        {
+            return (static_cast<uint64_t>(v) << 1) ^
+                   static_cast<uint64_t>(v >> 63);
+        }
+        static int64_t zigzagDecode(uint64_t v)
+        {
+            return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+        }
         size_t head_;
         size_t initCap_;
         std::vector<char> buffer_;